@@ -71,7 +71,10 @@ use P4::Revision;
 use P4::Integration;
 use P4::Resolver;
 use P4::IterateSpec;
-use Scalar::Util qw( tainted );
+use P4::Map;
+use P4::PrintCache;
+use P4::Handler;
+use Scalar::Util qw( tainted reftype );
 
 use vars qw( @ISA @EXPORT @EXPORT_OK $AUTOLOAD );
 
@@ -191,6 +194,11 @@ For example:
 
 =over
 
+=item GetAutoResolve()
+
+Returns true if clean resolves are being accepted without calling the
+resolver. See SetAutoResolve().
+
 =item GetCharset()
 
 Return the name of the current charset in use. Applicable only when
@@ -233,6 +241,10 @@ or 0 if no limit is in place. Note that the limits set by
 the administrator in group specifications are not visible through 
 this interface.
 
+=item GetOutputUtf8()
+
+Returns the mode set with SetOutputUtf8().
+
 =item GetPassword()
 
 Returns your Perforce password. Taken from a previous call to 
@@ -245,10 +257,19 @@ Returns the current address for your Perforce server. Taken from
 a previous call to SetPort(), the environment ($ENV{P4PORT}),
 or a P4CONFIG file.
 
+=item GetPrintCache()
+
+Returns the P4::PrintCache object set with SetPrintCache(), or undef.
+
 =item GetProg()
 
 Get the name of your script. See L</SetProg>, below.
 
+=item GetSyncIOPolicy()
+
+Returns the options set with SetSyncIOPolicy() as a hashref, or undef
+if sync is writing files the API's default way.
+
 =item GetTicketFile()
 
 Returns the path to the file where the user's login tickets
@@ -271,11 +292,79 @@ L<SetVersion()>.
 
 Returns 1 if tagged output is enabled, zero if it is disabled.
 
+=item LastRunMemory()
+
+When enabled with SetRunMemory(), returns a reference to a hash
+estimating the Perl memory used by the output of the most recent
+command:
+
+    Records	    number of output records created
+    SVs, AVs, HVs   scalars, arrays and hashes in those records
+    Bytes	    approximate bytes allocated for them
+    LargestRecord   approximate bytes in the largest record
+    ResidentRecords records, messages and track lines still held
+		    in the results when the command finished
+    ResidentBytes   approximate bytes held by those
+    PeakRSS	    the process' peak resident set size in KB, or
+		    0 where this is not available
+
+Records consumed by an output handler count towards Bytes but not
+ResidentBytes. Byte counts are estimated from Perl's internal
+structure sizes, so treat them as a guide rather than an exact
+figure. Returns undef if accounting is not enabled.
+
+=item LastRunStats()
+
+When enabled with SetRunStats(), returns a reference to a hash
+describing where the time went in the most recent command:
+
+    Command	    the command run
+    Wall	    total elapsed time, in seconds
+    ServerWait	    time not accounted for below: network, server
+		    and API processing
+    Conversion	    time converting tagged output to Perl hashes
+    Spec	    time parsing forms into P4::Spec objects
+    Callback	    time spent in output handler methods
+    Records	    number of output records
+    Messages	    number of errors, warnings and messages
+    Bytes	    bytes of output data received
+
+Returns undef if statistics are not enabled.
+
 =item P4ConfigFile()
 
 Returns the path to the current P4CONFIG file, if any, that is
 in effect.
 
+=item ProgressStats()
+
+Returns a reference to a hash of the progress recorded for the
+current, or most recent, command when SetProgressStats() is
+enabled; undef otherwise. The hash is keyed on progress type
+(1 = sending files, 2 = receiving files, 3 = files transferred,
+4 = computation) and each value is a hash containing Description,
+Units, Total, Position, Elapsed (seconds), Rate (units per second),
+Done and Failed. It may be polled while a command is running, for
+example from an output handler, or afterwards.
+
+=item ResultCacheStats()
+
+Returns a reference to a hash describing the result cache enabled
+with SetResultCache(), with the keys Entries, Bytes, Limit, Hits,
+Misses and Stores. Returns undef if the cache is not enabled.
+
+=item SetAutoResolve( [0|1] )
+
+When enabled, RunResolve() accepts the server's suggestion itself
+whenever it's clean, without creating a P4::MergeData or calling the
+P4::Resolver: merges with no conflicts, and files changed only on
+one side. The resolver is called only for conflicts, and for action
+resolves (moves, deletes, filetype changes and so on) where both
+sides acted. Without a resolver, those are skipped. Off by default.
+
+    $p4->SetAutoResolve( 1 );
+    $p4->RunResolve( $resolver, "//ws/..." );	# conflicts only
+
 =item SetCharset( $charset )
 
 Specify the character set to use for local files when used with a
@@ -338,6 +427,35 @@ that once set, this limit remains in force. You can remove the
 restriction by setting it to a value of 0.
 
 
+=item SetOutputUtf8( [0|1|2] )
+
+When a charset has been set with SetCharset(), the server's output is
+translated to UTF-8, but by default it is returned as byte strings that
+need decoding with Encode::decode_utf8(). In mode 1, strings containing
+non-ASCII characters are marked as UTF-8 character strings as they are
+created, so no decoding is needed. Mode 2 does the same, but first checks
+that each such string is valid UTF-8 and leaves it as bytes if not. Mode
+0, the default, returns byte strings as before.
+
+File content, for example from 'p4 print', is translated to the charset
+set with SetCharset() rather than to UTF-8, so it is only marked when
+that charset is 'utf8' or 'utf8-bom'. Binary output is never marked,
+and nothing is marked when no charset is set.
+
+=item SetParallelSubmit( $threads [, $batch, $min, $minsize ] )
+
+Submit files over $threads parallel connections. The options are
+added to every subsequent submit as C<--parallel=threads=N,...>
+unless the command already has a C<--parallel> argument. $batch is
+the number of files sent per batch, and a submit goes parallel only
+when at least $min files, or $minsize bytes, are to be sent. Any of
+these left at zero takes the value of the corresponding
+C<net.parallel.submit.*> configurable. Pass 0 threads to go back to
+a single connection.
+
+    $p4->SetParallelSubmit( 8, 8, 9, 512 * 1024 );
+    $p4->RunSubmit( "-d", "Publish build artifacts" );
+
 =item SetPassword( $password )
 
 Specify the password to use when authenticating this user against
@@ -353,12 +471,137 @@ to:
     2. Value from $ENV{P4PORT}
     3. perforce:1666
 
+=item SetPrintCache( $cache )
+
+Sets a P4::PrintCache object to be consulted when printing specific
+revisions of files, so that revisions already printed are read from
+local disk rather than the server. Pass undef to stop using the cache.
+See L<P4::PrintCache> for the details.
+
 =item SetProg( $program_name )
 
 Set the name of your script. This value is displayed in the server log
 on 2004.2 or later servers. Defaults to 'Unnamed P4Perl Script' if
 not specified.
 
+=item SetProgressRate( $interval [, $delta ] )
+
+Limits how often the Update() method of the progress object set
+with SetProgress() is called. An update is passed on only when
+at least $interval milliseconds and $delta units have passed
+since the last update delivered; the rest are discarded without
+calling into Perl. The first update, an update that reaches the
+total and the final position before Done() are always delivered.
+Setting both values to 0 (the default) delivers every update.
+
+=item SetProgressStats( [0|1] )
+
+Enables or disables the built-in progress statistics. When
+enabled, the progress reported by the server during each command
+is recorded natively, without calling into Perl, whether or not a
+progress object has been set with SetProgress(). Read the
+statistics with ProgressStats().
+
+=item SetResolvePolicy( [ $pattern => $action, ... ] )
+
+Settles resolves according to a table of path patterns, without
+calling a P4::Resolver for each file. Each $action is one of:
+
+    am		accept the merge, if there are no conflicts;
+		otherwise the resolver is asked
+    at		accept theirs
+    ay		accept yours
+    s		skip
+    perl	ask the resolver
+
+Patterns use the usual Perforce wildcards and are matched against
+the target file in client syntax and then the source file in depot
+syntax. As with a client view, later rules override earlier ones,
+and a pattern beginning with '-' excludes files. Files no rule
+matches go to the resolver; if no resolver was passed to
+RunResolve(), they're skipped. The policy stays in force until
+cleared with undef.
+
+    $p4->SetResolvePolicy( [ "//depot/main/gen/..."    => "at",
+			     "//depot/main/....html"   => "am",
+			     "//depot/main/lib/..."    => "perl" ] );
+    $p4->RunResolve( $resolver, "//ws/..." );
+
+=item SetResultCache( $bytes )
+
+Enables an in-memory cache of the results of commands whose output can
+never change, holding up to approximately $bytes of results. When
+enabled, repeating such a command returns a copy of the earlier
+results without contacting the server. Passing 0 disables the cache
+and discards its contents. The cache is off by default.
+
+Only the following are cached, and only when every file argument is
+in depot syntax and refers to either a specific revision of a single
+file (C<//depot/path#3>) or to the revisions submitted in a given
+change (C<//depot/path/...@=1234>):
+
+    describe	(tagged mode, and only for submitted changes)
+    print
+    fstat	(only when the output doesn't include any workspace
+		 state, such as haveRev, action or clientFile)
+
+Commands run with an output handler, and commands that produce
+warnings, errors or no output, are never cached. Entries are keyed on
+the port, user, client, charset, API level and tagged mode in effect,
+as well as the command and its arguments. The least recently used
+entries are discarded when the cache is full.
+
+ClearResultCache() discards the cached results but leaves the cache
+enabled. See also ResultCacheStats().
+
+=item SetResultSizeHint( $count )
+
+Tells P4Perl how many results the next command is expected to return,
+for example from an earlier 'p4 sizes -s', so that space for them can
+be allocated in one go. The hint applies to the next command only.
+Without a hint, the value of a -m argument or of SetMaxResults() is
+used, but only for the commands where it limits the number of records
+returned: branches, changes, clients, files, fixes, fstat, jobs,
+labels, opened, streams, users and workspaces. Hints only affect
+performance, never the results.
+
+=item SetRunMemory( [0|1] )
+
+Enables or disables the accounting of memory used by command
+output, which can then be read with LastRunMemory(). Accounting is
+off by default; when on, each output record is walked once as it
+is created.
+
+=item SetRunStats( [0|1] )
+
+Enables or disables the collection of timing statistics for each
+command run, which can then be read with LastRunStats(). Collection
+is off by default; when on, it adds a few clock reads per output
+record.
+
+=item SetSyncIOPolicy( \%options )
+
+Changes how sync writes files, which can help a lot with many small
+files, or on network filesystems where each write and fsync is
+expensive. The options are:
+
+    buffer	size of the write buffer, in bytes
+    presize	if true, size each file's buffer to the file (up to
+		'buffer', or 4MB) when the server reports its size,
+		so that it's written in one go
+    fsync	fsync files, and the directories they're in, in groups
+		of this many on a background thread instead of one at
+		a time; sync doesn't return until all are on disk,
+		and warns if any couldn't be synced. On Windows
+		each file is fsynced as it's closed instead
+
+Options left out, or zero, keep the API's default behaviour. The policy
+applies to sync, including parallel sync threads; pass undef to go
+back to the defaults.
+
+    $p4->SetSyncIOPolicy( { buffer => 1024 * 1024, presize => 1, 
+			    fsync => 256 } );
+
 =item SetTicketFile( $path )
 
 Set the path to the file in which login tickets are stored. If not
@@ -385,6 +628,45 @@ Set the Perforce username to use. Defaults to:
 Sets the version string of your program. This can be included
 in the Perforce Server's logfile.
 
+=item SetVirtualWorkspace( $target )
+
+Sync files somewhere other than the client's root. $target may be:
+
+=over
+
+=item a code ref
+
+called as C<< $code->( $path, $content, \%details ) >> for each file,
+or C<< $code->( $path, undef ) >> when one is deleted.
+
+=item a hash ref
+
+which gets an entry for each file, keyed by its path, holding the
+same details plus C<content>. Deleted files are removed.
+
+=item a filehandle
+
+to which a tar archive of the files is written. The archive is
+finished when the virtual workspace is cleared.
+
+=back
+
+The details are the file's C<type> (text, binary, symlink, unicode or
+utf16, with C<+x> if executable), the MD5 C<digest> of the content and
+its C<size>. Text has Unix line endings and no charset translation, so
+the digest matches the one C<fstat -Ol> reports. Paths are the local
+paths the files would have had.
+
+Only sync is affected: other commands use the real workspace as usual.
+Transfers aren't run in parallel while a virtual workspace is set. Use
+C<sync -p> if the server shouldn't record the files as synced. Pass
+undef to go back to the real workspace.
+
+    my %files;
+    $p4->SetVirtualWorkspace( \%files );
+    $p4->RunSync( "-p", "//depot/project/..." );
+    $p4->SetVirtualWorkspace( undef );
+
 =item Tagged( [0|1] )
 
 Enable or disable tagged output. Responses from commands that 
@@ -454,6 +736,15 @@ for almost all commands.
 You can disable tagged output, and thus get all your results
 as strings, by calling C<< $p4->Tagged( 0 ); >> at any time.
 
+Commands that support parallel file transfer (sync, shelve and
+submit with C<--parallel>, or when C<net.parallel.threads> is set)
+move their files over extra connections, one per thread, just as
+the command line client does. If a progress object has been set
+with C<SetProgress()>, each thread's progress is reported to it
+separately, with the thread number at the start of the description.
+
+  $p4->RunSync( "--parallel=threads=4", "//depot/project/..." );
+
 =over
 
 =head2 TIP
@@ -525,9 +816,9 @@ required. For example:
 
 =item RunSubmit( [ $spec | $arg ] ... )
 
-Submits a changelist. If a hashref is passed as one of the 
-arguments, it is taken to be the change specification form
-and is passed to the server as input to a C<p4 submit -i>.
+Submits a changelist. If a hashref, filehandle or code ref is passed
+as one of the arguments, it is taken to supply the change specification
+form and is passed to the server as input to a C<p4 submit -i>.
 
 If no change spec is supplied, then the submit is executed
 as it stands.
@@ -545,16 +836,49 @@ Or with a 2006.2, or later, server:
 =item SetInput( $arg )
 
 Save the supplied argument as input to be supplied to a subsequent 
-command.  The input may be: a hashref, a scalar string or an array 
-of hashrefs or scalar strings. Note that if you pass an array the
-array will be shifted once each time the Perforce command in
+command.  The input may be: a hashref, a scalar string, a filehandle,
+a code ref or an array of any of these. Note that if you pass an array
+the array will be shifted once each time the Perforce command in
 question asks for user input. A good example of this is 
 'p4 password' which prompts once for the old password, and then
 twice for the new password.
 
+A filehandle is read to the end when the server asks for input, and
+a code ref is called repeatedly, with each string it returns appended
+to the input, until it returns undef or an empty string. A code ref
+may instead return a hashref, from its first call, to be formatted as
+a spec; any other reference fails the command. Either way,
+large inputs such as a change with a long list of files needn't be
+held in memory as a Perl string first:
+
+    open( my $fh, "<", "change.txt" ) or die;
+    $p4->RunSubmit( $fh );
+
 Most people won't need to call this method as the wrappers around
 C<Run()> take care of this for you.
 
+=item TrackStats()
+
+When performance tracking has been enabled with SetTrack(), returns a
+reference to a hash of the tracking data from the last command,
+parsed as it was received:
+
+    Lapse	    server elapsed time in seconds
+    Usage	    UserTime and SystemTime (ms), IoIn, IoOut, NetIn,
+		    NetOut, MaxRss (bytes) and PageFaults
+    Rpc		    MsgsIn, MsgsOut, BytesIn, BytesOut, HimarkFwd,
+		    HimarkRev, SendTime and RecvTime (seconds)
+    Tables	    a hash keyed on table name (e.g. 'db.have'), each
+		    holding PagesIn, PagesOut, PagesCached, ReadLocks,
+		    WriteLocks, RowsGet, RowsPos, RowsScan, RowsPut,
+		    RowsDel, ReadWait, ReadHeld, WriteWait, WriteHeld,
+		    MaxReadWait, MaxReadHeld, MaxWriteWait, MaxWriteHeld,
+		    PeekCount, PeekWait and PeekHeld (times in ms)
+
+Keys are present only for the lines the server sent. Sizes the server
+reports in kb or mb are converted to bytes, so they are only as precise
+as the server's figures. Returns undef if tracking is not enabled.
+
 =item WarningCount()
 
 Returns the number of warnings issued by the last command.
@@ -838,7 +1162,8 @@ The differences are documented in the P4Perl release notes in the file
 =head1 SEE ALSO
 
 L<perl>, L<P4::DepotFile>, L<P4::Revision>, L<P4::Integration>,
-L<P4::Resolver>, L<P4::MergeData>, L<P4::Message>, L<P4::Progress>
+L<P4::Resolver>, L<P4::MergeData>, L<P4::Message>, L<P4::Progress>,
+L<P4::PrintCache>
 
 =head1 COPYRIGHT
 
@@ -861,6 +1186,14 @@ sub Run {
 		}
 	}
 
+	# Printing specific revisions may be answered by the print cache
+	if ( $_[0] eq "print" ) {
+		if ( my $cache = $self->_PrintCache() ) {
+			my $r = $cache->Run( $self, @_[ 1 .. $#_ ] );
+			return wantarray ? @$r : $r if ($r);
+		}
+	}
+
 	return $self->_Run(@_);
 }
 
@@ -936,8 +1269,8 @@ sub RunTickets {
 # RunSubmit	- "p4 submit -i"
 #
 # Submit a changelist to the server. if one of the supplied arguments is a
-# hashref, then it will be assumed to contain the change form ready to be
-# sent to the server.
+# hashref, filehandle or code ref, then it will be assumed to supply the
+# change form ready to be sent to the server.
 #
 # Synopsis:	$p4->RunSubmit( args... );
 sub RunSubmit( $@ ) {
@@ -946,8 +1279,13 @@ sub RunSubmit( $@ ) {
 	my $haveSpec = 0;
 
 	foreach my $arg (@_) {
-		if ( ref($arg) eq "HASH" || ref($arg) eq "P4::Spec" ) {
-			$self->SetInput(shift);
+		my $type = reftype($arg) || "";
+		if (   ref($arg) eq "HASH"
+			|| ref($arg) eq "P4::Spec"
+			|| $type eq "GLOB"
+			|| $type eq "CODE" )
+		{
+			$self->SetInput($arg);
 			$haveSpec++;
 		}
 		else {
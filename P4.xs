@@ -40,6 +40,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "p4mapmaker.h"
 #include "p4actionmerge.h"
 #include "p4dvcsclient.h"
+#include "p4nativehandler.h"
 
 /*
  * The architecture of this extension is relatively complex. The main Perl
@@ -110,6 +111,30 @@ ExtractError( SV *var )
     return INT2PTR( Error *, SvIV( SvRV( var ) ) );
 }
 
+static P4NativeHandler *
+ExtractNativeHandler( SV *var )
+{
+    return INT2PTR( P4NativeHandler *, SvIV( SvRV( var ) ) );
+}
+
+/*
+ * Bless a pointer to a native handler into one of the P4::Handler classes.
+ * If it couldn't be set up, it's deleted and undef returned.
+ */
+static SV *
+NewNativeHandler( const char *CLASS, P4NativeHandler *h, int ok )
+{
+    if( !ok )
+    {
+	delete h;
+	return &PL_sv_undef;
+    }
+
+    SV *rv = newRV_noinc( newSViv( PTR2IV( h ) ) );
+    sv_bless( rv, gv_stashpv( CLASS, TRUE ) );
+    return rv;
+}
+
 
 /*
  * P4::Message class - for holding warnings and errors.
@@ -307,6 +332,71 @@ MergeHint( THIS )
 	OUTPUT:
 	    RETVAL
 
+SV *
+YourChunks( THIS )
+	SV 	*THIS
+
+	INIT:
+	    P4MergeData *	m;
+	CODE:
+	    m = ExtractMergeData( THIS );
+	    if( !m ) XSRETURN_UNDEF;
+	    RETVAL = m->GetYourChunks();
+	OUTPUT:
+	    RETVAL
+
+SV *
+TheirChunks( THIS )
+	SV 	*THIS
+
+	INIT:
+	    P4MergeData *	m;
+	CODE:
+	    m = ExtractMergeData( THIS );
+	    if( !m ) XSRETURN_UNDEF;
+	    RETVAL = m->GetTheirChunks();
+	OUTPUT:
+	    RETVAL
+
+SV *
+BothChunks( THIS )
+	SV 	*THIS
+
+	INIT:
+	    P4MergeData *	m;
+	CODE:
+	    m = ExtractMergeData( THIS );
+	    if( !m ) XSRETURN_UNDEF;
+	    RETVAL = m->GetBothChunks();
+	OUTPUT:
+	    RETVAL
+
+SV *
+ConflictChunks( THIS )
+	SV 	*THIS
+
+	INIT:
+	    P4MergeData *	m;
+	CODE:
+	    m = ExtractMergeData( THIS );
+	    if( !m ) XSRETURN_UNDEF;
+	    RETVAL = m->GetConflictChunks();
+	OUTPUT:
+	    RETVAL
+
+SV *
+Stats( THIS )
+	SV 	*THIS
+
+	INIT:
+	    P4MergeData *	m;
+	CODE:
+	    m = ExtractMergeData( THIS );
+	    if( !m ) XSRETURN_UNDEF;
+	    RETVAL = newRV_noinc( (SV *) m->GetStats() );
+	OUTPUT:
+	    RETVAL
+
 SV *
 RunMergeTool( THIS )
 	SV 	*THIS
@@ -417,6 +507,128 @@ MergeHint( THIS )
 	OUTPUT:
 	    RETVAL		 
 
+#
+# P4::Handler classes - output handlers that never call into Perl. The
+# subclasses differ only in how they're constructed.
+#
+MODULE = P4		PACKAGE = P4::Handler
+VERSIONCHECK: DISABLE
+PROTOTYPES:	DISABLE
+
+void
+DESTROY( THIS )
+	SV	*THIS
+
+	INIT:
+	    P4NativeHandler *	h;
+
+	CODE:
+	    h = ExtractNativeHandler( THIS );
+	    if( !h ) XSRETURN_UNDEF;
+	    delete h;
+
+int
+Count( THIS )
+	SV	*THIS
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = ExtractNativeHandler( THIS );
+	    if( !h ) XSRETURN_UNDEF;
+	    RETVAL = h->GetCount();
+	OUTPUT:
+	    RETVAL
+
+SV *
+Values( THIS )
+	SV	*THIS
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = ExtractNativeHandler( THIS );
+	    if( !h ) XSRETURN_UNDEF;
+	    RETVAL = newRV_inc( (SV *) h->GetValues() );
+	OUTPUT:
+	    RETVAL
+
+void
+Reset( THIS )
+	SV	*THIS
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = ExtractNativeHandler( THIS );
+	    if( !h ) XSRETURN_UNDEF;
+	    h->Reset();
+
+
+MODULE = P4		PACKAGE = P4::Handler::Count
+
+SV *
+new( CLASS )
+	char	*CLASS
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = new P4NativeHandler( P4NativeHandler::NH_COUNT );
+	    RETVAL = NewNativeHandler( CLASS, h, 1 );
+	OUTPUT:
+	    RETVAL
+
+
+MODULE = P4		PACKAGE = P4::Handler::Collect
+
+SV *
+new( CLASS, field )
+	char	*CLASS
+	SV	*field
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = new P4NativeHandler( P4NativeHandler::NH_COLLECT );
+	    RETVAL = NewNativeHandler( CLASS, h, h->SetField( field ) );
+	OUTPUT:
+	    RETVAL
+
+
+MODULE = P4		PACKAGE = P4::Handler::Grep
+
+SV *
+new( CLASS, field, pattern )
+	char	*CLASS
+	SV	*field
+	SV	*pattern
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = new P4NativeHandler( P4NativeHandler::NH_GREP );
+	    RETVAL = NewNativeHandler( CLASS, h, h->SetPattern( field, pattern ) );
+	OUTPUT:
+	    RETVAL
+
+
+MODULE = P4		PACKAGE = P4::Handler::ToFile
+
+SV *
+new( CLASS, fh, format = &PL_sv_undef )
+	char	*CLASS
+	SV	*fh
+	SV	*format
+
+	INIT:
+	    P4NativeHandler *	h;
+	CODE:
+	    h = new P4NativeHandler( P4NativeHandler::NH_TOFILE );
+	    RETVAL = NewNativeHandler( CLASS, h, h->SetFile( fh, format ) );
+	OUTPUT:
+	    RETVAL
+
 #
 # Now, we switch to the P4::Map class.
 #
@@ -545,6 +757,89 @@ Join( map1, map2 )
 	OUTPUT:
 	    RETVAL
 	    
+SV *
+JoinAll( ... )
+	INIT:
+	    P4MapMaker **	maps;
+	    P4MapMaker *	j;
+	    HV *		stash;
+	    I32			first = 0;
+	    I32			i;
+
+	CODE:
+	    /* Allow both P4::Map->JoinAll(...) and P4::Map::JoinAll(...) */
+	    if( items && !SvROK( ST( 0 ) ) )
+		first = 1;
+
+	    Newxz( maps, items - first + 1, P4MapMaker * );
+	    SAVEFREEPV( maps );
+
+	    for( i = first; i < items; i++ )
+	    {
+		if( !sv_isobject( ST( i ) ) || !sv_derived_from( ST( i ), "P4::Map" ) )
+		    croak( "Usage: P4::Map->JoinAll( $map1, $map2, ... )" );
+		maps[ i - first ] = ExtractMapMaker( ST( i ) );
+	    }
+
+	    j = P4MapMaker::JoinAll( maps, items - first );
+
+	    RETVAL = newSViv( PTR2IV( j ) );
+
+	    /* Return a blessed reference to the IV */
+	    RETVAL = newRV_noinc( RETVAL );
+	    stash = gv_stashpv( "P4::Map", TRUE );
+	    sv_bless( RETVAL, stash );
+	    
+	OUTPUT:
+	    RETVAL
+
+void
+ClearJoinCache( ... )
+	CODE:
+	    P4MapMaker::ClearJoinCache();
+
+SV *
+Thaw( CLASS, data )
+	char *	CLASS
+	SV *	data
+	INIT:
+	    P4MapMaker *	m;
+	    HV *		stash;
+	    char *		p;
+	    STRLEN		len;
+
+	CODE:
+	    p = SvPV( data, len );
+	    m = P4MapMaker::Thaw( p, len );
+	    if( !m )
+	    {
+		warn( "Invalid or corrupt frozen P4::Map data" );
+		XSRETURN_UNDEF;
+	    }
+
+	    RETVAL = newSViv( PTR2IV( m ) );
+
+	    /* Return a blessed reference to the IV */
+	    RETVAL = newRV_noinc( RETVAL );
+	    stash = gv_stashpv( CLASS, TRUE );
+	    sv_bless( RETVAL, stash );
+
+	OUTPUT:
+	    RETVAL
+
+SV *
+Freeze( THIS )
+	SV *	THIS
+	INIT:
+	    P4MapMaker *	m;
+
+	CODE:
+	    m = ExtractMapMaker( THIS );
+	    RETVAL = m->Freeze();
+
+	OUTPUT:
+	    RETVAL
+
 void
 Insert( THIS, lhs, ... )
 	SV *	THIS
@@ -607,6 +902,28 @@ Reverse( THIS )
 	OUTPUT:
 	    RETVAL
 
+SV *
+Clone( THIS )
+	SV *	THIS
+	INIT:
+	    P4MapMaker *	m;
+	    P4MapMaker *	m2;
+	    HV *		stash;
+
+	CODE:
+	    m = ExtractMapMaker( THIS );
+	    m2 = new P4MapMaker( *m );
+
+	    RETVAL = newSViv( PTR2IV( m2 ) );
+
+	    /* Return a blessed reference to the IV */
+	    RETVAL = newRV_noinc( RETVAL );
+	    stash = gv_stashpv( "P4::Map", TRUE );
+	    sv_bless( RETVAL, stash );
+	    
+	OUTPUT:
+	    RETVAL
+
 void
 Clear( THIS )
 	SV *	THIS
@@ -688,32 +1005,88 @@ Translate( THIS, ... )
 	OUTPUT:
 	    RETVAL
 	    
+SV *
+TranslateArray( THIS, paths, ... )
+	SV *	THIS
+	SV *	paths
+	INIT:
+	    P4MapMaker *	m;
+	    int			fwd = 1;
+
+	CODE:
+	    m = ExtractMapMaker( THIS );
+
+	    if( !SvROK( paths ) || SvTYPE( SvRV( paths ) ) != SVt_PVAV )
+		croak("Usage: P4::Map::TranslateArray( THIS, $arrayref [, $fwd=1] )" );
+
+	    if( items > 2 )
+		fwd = SvIV( ST( 2 ) );
+
+	    RETVAL = newRV_noinc( (SV*) m->TranslateArray( (AV*) SvRV( paths ), fwd ) );
+
+	OUTPUT:
+	    RETVAL
+	    
 SV *
 Includes( THIS, string )
 	SV *	THIS
 	SV *	string
 	INIT:
 	    P4MapMaker *	m;
-	    SV *		s;
+	    char *		p;
+	    STRLEN		len;
 
 	CODE:
-	    RETVAL = &PL_sv_no;
 	    m = ExtractMapMaker( THIS );
-	    s = m->Translate( string );
-	    if( s )
-	    {
-		sv_2mortal( s );
+	    p = SvPV( string, len );
+	    if( m->Includes( p, len ) )
 		RETVAL = &PL_sv_yes;
-	    }
 	    else
-	    {
-		s = m->Translate( string, 0 );
-		if( s )
-		{
-		    sv_2mortal( s );
-		    RETVAL = &PL_sv_yes;
-		}
-	    }
+		RETVAL = &PL_sv_no;
+
+	OUTPUT:
+	    RETVAL
+
+SV *
+IncludesArray( THIS, paths )
+	SV *	THIS
+	SV *	paths
+	INIT:
+	    P4MapMaker *	m;
+
+	CODE:
+	    m = ExtractMapMaker( THIS );
+
+	    if( !SvROK( paths ) || SvTYPE( SvRV( paths ) ) != SVt_PVAV )
+		croak("Usage: P4::Map::IncludesArray( THIS, $arrayref )" );
+
+	    RETVAL = newRV_noinc( (SV*) m->IncludesArray( (AV*) SvRV( paths ) ) );
+
+	OUTPUT:
+	    RETVAL
+
+void
+Compile( THIS )
+	SV *	THIS
+	INIT:
+	    P4MapMaker *	m;
+
+	CODE:
+	    m = ExtractMapMaker( THIS );
+	    m->Compile();
+
+SV *
+IsCompiled( THIS )
+	SV *	THIS
+	INIT:
+	    P4MapMaker *	m;
+
+	CODE:
+	    m = ExtractMapMaker( THIS );
+	    if( m->IsCompiled() )
+		RETVAL = &PL_sv_yes;
+	    else
+		RETVAL = &PL_sv_no;
 
 	OUTPUT:
 	    RETVAL
@@ -945,78 +1318,138 @@ GetClient( THIS )
 	SV 	*THIS
 
 	INIT:
-	    PerlClientApi*	c;
+	    PerlClientApi*	c;
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetClient();
+	OUTPUT:
+	    RETVAL
+
+SV *
+GetCwd( THIS )
+	SV 	*THIS
+
+	INIT:
+	    PerlClientApi *	c;
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetCwd();
+	OUTPUT:
+	    RETVAL
+
+SV *
+GetEnv( THIS, var )
+	SV 	*THIS
+	const char *var
+
+	INIT:
+	    PerlClientApi *	c;
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetEnv( var ); 
+	OUTPUT:
+	    RETVAL
+
+SV *
+GetHost( THIS )
+	SV 	*THIS
+
+	INIT:
+	    PerlClientApi *	c;
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetHost();
+	OUTPUT:
+	    RETVAL
+
+SV *
+GetHandler( THIS )
+	SV *THIS
+	
+	INIT:
+	    PerlClientApi *	c;
+	PPCODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    ST(0) = c->GetHandler();
+	    XSRETURN(1);		
+
+SV *
+GetProgress( THIS )
+	SV *THIS
+	
+	INIT:
+	    PerlClientApi *	c;
+	PPCODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    ST(0) = c->GetProgress();
+	    XSRETURN(1);	
+	    
+SV *
+LastRunStats( THIS )
+	SV *	THIS
+
+	INIT:
+	    PerlClientApi *	c;
+
 	CODE:
 	    c = ExtractClient( THIS );
 	    if( !c ) XSRETURN_UNDEF;
-	    RETVAL = c->GetClient();
+	    RETVAL = c->GetRunStats();
+
 	OUTPUT:
 	    RETVAL
 
 SV *
-GetCwd( THIS )
-	SV 	*THIS
+LastRunMemory( THIS )
+	SV *	THIS
 
 	INIT:
 	    PerlClientApi *	c;
+
 	CODE:
 	    c = ExtractClient( THIS );
 	    if( !c ) XSRETURN_UNDEF;
-	    RETVAL = c->GetCwd();
+	    RETVAL = c->GetRunMemory();
+
 	OUTPUT:
 	    RETVAL
 
 SV *
-GetEnv( THIS, var )
-	SV 	*THIS
-	const char *var
+ResultCacheStats( THIS )
+	SV *	THIS
 
 	INIT:
 	    PerlClientApi *	c;
+
 	CODE:
 	    c = ExtractClient( THIS );
 	    if( !c ) XSRETURN_UNDEF;
-	    RETVAL = c->GetEnv( var ); 
+	    RETVAL = c->GetResultCacheStats();
+
 	OUTPUT:
 	    RETVAL
 
 SV *
-GetHost( THIS )
-	SV 	*THIS
+ProgressStats( THIS )
+	SV *	THIS
 
 	INIT:
 	    PerlClientApi *	c;
+
 	CODE:
 	    c = ExtractClient( THIS );
 	    if( !c ) XSRETURN_UNDEF;
-	    RETVAL = c->GetHost();
+	    RETVAL = c->GetProgressStats();
+
 	OUTPUT:
 	    RETVAL
 
-SV *
-GetHandler( THIS )
-	SV *THIS
-	
-	INIT:
-	    PerlClientApi *	c;
-	PPCODE:
-	    c = ExtractClient( THIS );
-	    if( !c ) XSRETURN_UNDEF;
-	    ST(0) = c->GetHandler();
-	    XSRETURN(1);		
-
-SV *
-GetProgress( THIS )
-	SV *THIS
-	
-	INIT:
-	    PerlClientApi *	c;
-	PPCODE:
-	    c = ExtractClient( THIS );
-	    if( !c ) XSRETURN_UNDEF;
-	    ST(0) = c->GetProgress();
-	    XSRETURN(1);	
-	    
 SV *
 GetLanguage( THIS )
 	SV 	*THIS
@@ -1811,6 +2244,207 @@ SetProgress( THIS, value )
 	    if( !c ) XSRETURN_UNDEF;
 	    c->SetProgress( value );	
 
+void
+SetAutoResolve( THIS, flag )
+	SV *	THIS
+	int	flag
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetAutoResolve( flag );
+
+int
+GetAutoResolve( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetAutoResolve();
+
+	OUTPUT:
+	    RETVAL
+
+void
+SetResolvePolicy( THIS, rules )
+	SV *	THIS
+	SV *	rules
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetResolvePolicy( rules );
+
+void
+SetResultCache( THIS, bytes )
+	SV *	THIS
+	IV	bytes
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetResultCache( (long) bytes );
+
+void
+ClearResultCache( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->ClearResultCache();
+
+void
+SetPrintCache( THIS, cache )
+	SV *	THIS
+	SV *	cache
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetPrintCache( cache );
+
+SV *
+GetPrintCache( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetPrintCache( 0 );
+
+	OUTPUT:
+	    RETVAL
+
+SV *
+_PrintCache( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetPrintCache( 1 );
+
+	OUTPUT:
+	    RETVAL
+
+void
+_ResetResults( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->ResetResults();
+
+void
+SetOutputUtf8( THIS, mode )
+	SV *	THIS
+	int	mode
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetOutputUtf8( mode );
+
+int
+GetOutputUtf8( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetOutputUtf8();
+
+	OUTPUT:
+	    RETVAL
+
+void
+SetResultSizeHint( THIS, count )
+	SV *	THIS
+	int	count
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetResultSizeHint( count );
+
+void
+SetRunMemory( THIS, enable )
+	SV *	THIS
+	int	enable
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetRunMemory( enable );
+
+void
+SetRunStats( THIS, enable )
+	SV *	THIS
+	int	enable
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetRunStats( enable );
+
+void
+SetProgressStats( THIS, enable )
+	SV *	THIS
+	int	enable
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetProgressStats( enable );
+
+void
+SetProgressRate( THIS, interval, ... )
+	SV *	THIS
+	int	interval
+	INIT:
+	    PerlClientApi *	c;
+	    long		delta = 0;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    if( items > 2 )
+		delta = SvIV( ST( 2 ) );
+	    c->SetProgressRate( interval, delta );
+
 void
 SetLanguage( THIS, lang )
 	SV *	THIS
@@ -1861,6 +2495,21 @@ SetMaxLockTime( THIS, value )
 	    c->SetMaxLockTime( value );
 
 
+void
+SetParallelSubmit( THIS, threads, batch = 0, min = 0, minsize = 0 )
+	SV *	THIS
+	int	threads
+	int	batch
+	int	min
+	long	minsize
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetParallelSubmit( threads, batch, min, minsize );
+
 void
 SetPassword( THIS, password )
 	SV *	THIS
@@ -1931,6 +2580,32 @@ SetStreams( THIS, flag )
             if( !c ) XSRETURN_UNDEF;
 	    c->SetStreams( flag );
 
+void
+SetSyncIOPolicy( THIS, options )
+	SV *	THIS
+	SV *	options
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetSyncIOPolicy( options );
+
+SV *
+GetSyncIOPolicy( THIS )
+	SV *	THIS
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetSyncIOPolicy();
+
+	OUTPUT:
+	    RETVAL
+
 void
 SetTicketFile( THIS,  path )
 	SV *	THIS
@@ -2016,6 +2691,18 @@ SetVersion( THIS, version )
 	    if( !c ) XSRETURN_UNDEF;
 	    c->SetVersion( version );
 
+void
+SetVirtualWorkspace( THIS, target )
+	SV *	THIS
+	SV *	target
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    c->SetVirtualWorkspace( target );
+
 SV *
 Tagged( THIS, flag, ... )
 	SV *	THIS
@@ -2072,6 +2759,21 @@ Tagged( THIS, flag, ... )
 
 
 
+SV *
+TrackStats( THIS )
+	SV *	THIS
+
+	INIT:
+	    PerlClientApi *	c;
+
+	CODE:
+	    c = ExtractClient( THIS );
+	    if( !c ) XSRETURN_UNDEF;
+	    RETVAL = c->GetTrackStats();
+
+	OUTPUT:
+	    RETVAL
+
 AV *
 TrackOutput( THIS )
 	SV *	THIS
@@ -0,0 +1,161 @@
+#-------------------------------------------------------------------------------
+# Copyright (c) 2026, Perforce Software, Inc.  All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 
+# 1.  Redistributions of source code must retain the above copyright
+#     notice, this list of conditions and the following disclaimer.
+# 
+# 2.  Redistributions in binary form must reproduce the above copyright
+#     notice, this list of conditions and the following disclaimer in the
+#     documentation and/or other materials provided with the distribution.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+package P4::Handler;
+
+=pod
+
+=head1 NAME
+
+P4::Handler - output handlers implemented in C++
+
+=head1 SYNOPSIS
+
+    use P4;
+
+    $p4 = new P4;
+    $p4->Connect();
+
+    $h = new P4::Handler::Collect( "depotFile" );
+    $p4->SetHandler( $h );
+    $p4->RunFiles( "//depot/..." );
+    @files = @{ $h->Values() };
+
+    $p4->SetHandler( new P4::Handler::Grep( "action" => qr/^(add|branch)$/ ) );
+    @added = $p4->RunFiles( "//depot/..." );
+
+    open( my $fh, ">", "changes.txt" ) or die;
+    $p4->SetHandler( new P4::Handler::ToFile( $fh, "%change% %user% %desc%" ) );
+    $p4->RunChanges( "-l", "//depot/..." );
+
+=head1 DESCRIPTION
+
+These classes take the place of a P4::OutputHandler subclass for the
+most common jobs. They are set with P4::SetHandler() in the same way,
+but are implemented in C++: tagged output is handed to them before it
+is converted to a Perl hash, and no Perl code is called for each
+record, so they cost little more than the server's output itself.
+
+A field matches both the key of that name and its indexed forms, so
+C<depotFile> picks up C<depotFile0>, C<depotFile1> and so on from
+commands such as C<describe>.
+
+Messages (errors and warnings) are never handled by these classes;
+they're returned from the command as usual. As with any handler, the
+handler is cleared at the end of each command.
+
+=head1 CLASSES
+
+=over
+
+=item new P4::Handler::Count()
+
+Counts the records output by the command, which returns none of them.
+
+=item new P4::Handler::Collect( $field )
+
+Gathers the values of $field from each tagged record into an array,
+returned by Values(). Records are not returned by the command.
+Untagged output is returned as usual.
+
+=item new P4::Handler::Grep( $field => $pattern )
+
+Keeps only the tagged records with a value of $field that matches
+$pattern, which may be a C<qr//> or a string. Untagged output is
+matched as a whole. Records that don't match are dropped without
+being converted to Perl data; those that do are returned by the
+command as usual.
+
+=item new P4::Handler::ToFile( $fh [, $format ] )
+
+Writes each record to the filehandle $fh. Untagged output is written
+as it arrives, with a newline after each line of info. Tagged records
+are written according to $format:
+
+=over
+
+=item ztag
+
+The default. Each field on a line of its own, as C<... field value>,
+with a blank line after each record, as in C<p4 -ztag>.
+
+=item json
+
+Each record as a JSON object on a line of its own (NDJSON), with the
+same structure as the hash the command would have returned: indexed
+fields such as C<depotFile0>, C<depotFile1> become arrays. All values
+are strings. The JSON is written straight from the server's output,
+without creating any Perl data, and untagged output is returned from
+the command rather than written.
+
+    open( my $fh, ">", "fstat.ndjson" ) or die;
+    $p4->SetHandler( new P4::Handler::ToFile( $fh, "json" ) );
+    $p4->RunFstat( "//depot/..." );
+
+=item a template
+
+Any other string containing C<%field%> is a template, written once for
+each record with each C<%field%> replaced by its value (or nothing, if
+the record doesn't have that field) and followed by a newline. C<%%>
+is a literal C<%>.
+
+=back
+
+If a write fails, the command is cancelled with a warning.
+
+=back
+
+=head1 OBJECT METHODS
+
+=over
+
+=item Count()
+
+Returns the number of records handled: all records for Count and
+ToFile, the records containing the field for Collect, and the matching
+records for Grep.
+
+=item Values()
+
+Returns a reference to the array of values collected by a Collect
+handler.
+
+=item Reset()
+
+Clears the count and any collected values, so that the handler can be
+used for another command.
+
+=back
+
+=head1 SEE ALSO
+
+L<P4>, L<P4::OutputHandler>
+
+=cut
+
+@P4::Handler::Count::ISA   = qw( P4::Handler );
+@P4::Handler::Collect::ISA = qw( P4::Handler );
+@P4::Handler::Grep::ISA    = qw( P4::Handler );
+@P4::Handler::ToFile::ISA  = qw( P4::Handler );
+
+1;
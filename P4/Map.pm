@@ -62,6 +62,35 @@ Join two maps together returning a new map containing the
 left-hand-side of $map1 joined to the right-hand-side of
 $map2.
 
+=item JoinAll( $map1, $map2, ... )
+
+Joins a chain of maps, returning a new map containing the
+left-hand-side of the first map joined through to the
+right-hand-side of the last. The result is the same as calling
+Join() on each pair in turn, but the joins are done in whichever
+order keeps the intermediate maps smallest, and the results are
+cached: joining the same maps again (or any chain sharing a run
+of the same maps) reuses the earlier work. Maps are identified
+by their contents, so modifying a map means it will be joined
+afresh. Call as P4::Map->JoinAll( @maps ).
+
+=item ClearJoinCache()
+
+Discards the results cached by JoinAll().
+
+=item Thaw( $string )
+
+Constructs a new P4::Map object from a string previously returned
+by Freeze(). The mappings are loaded directly, without being parsed
+again, so this is much faster than rebuilding a large map with
+Insert(). Returns undef (with a warning) if the string is not valid
+frozen map data. Call as P4::Map->Thaw( $string ).
+
+=item Load( $file )
+
+Reads a map previously written by Save() and returns a new P4::Map
+object, or undef on failure. Call as P4::Map->Load( $file ).
+
 =back
 
 =head1 INSTANCE METHODS
@@ -98,10 +127,38 @@ Returns non-zero if the Map object contains no mappings.
 Returns non-zero if the specified string is visible through
 either side of the mapping.
 
+=item IncludesArray( $arrayref )
+
+Tests every string in the referenced array as Includes() does,
+returning a reference to an array of 1/0 values in the same
+order. The Map is compiled (see Compile()) if it has not been
+already.
+
+=item Compile()
+
+Builds an index of the literal prefixes of the mappings so that
+Includes() and IncludesArray() can reject paths that cannot
+match without examining every line of the map. The index is
+discarded whenever the Map is modified, so compile after the
+last Insert(). Compiling does not change the result of any
+method; only its cost.
+
+=item IsCompiled()
+
+Returns true if the Map currently has a compiled index.
+
 =item Reverse()
 
-Reverses the mapping: swapping the left-hand-side with
-the right-hand-side and vice-versa.
+Returns a new Map with the left-hand-side and right-hand-side
+swapped. The new Map is a reversed view onto the same mappings
+as the original: no copy is made until one of them is modified,
+so reversing even a very large Map is cheap.
+
+=item Clone()
+
+Returns a copy of the Map. The copy shares its mappings with
+the original until either of them is modified, at which point
+the one being modified takes a private copy.
 
 =item Translate( $string [, $fwd=1 ] )
 
@@ -110,6 +167,15 @@ returns the result. The optional second parameter specifies
 the direction of translation: forward=1, reverse=0; the 
 default is to translate in the forward direction.
 
+=item TranslateArray( $arrayref [, $fwd=1 ] )
+
+Translates every string in the referenced array through the
+mappings in a single call and returns a reference to a new
+array of the same length. Entries that do not map are returned
+as undef. The direction of translation is specified as for
+Translate(). Use this in preference to calling Translate() in
+a loop when translating large numbers of paths.
+
 =item Lhs()
 
 Return an array containing the left-hand-side of the mapping
@@ -125,6 +191,18 @@ only.
 Return the mapping as an array of strings: one mapping per
 entry in the array.
 
+=item Freeze()
+
+Returns the Map in a compact binary form suitable for storing and
+later passing to Thaw(). Whether or not the Map was compiled is
+recorded too, so a thawed map is compiled if the original was.
+
+=item Save( $file )
+
+Writes the frozen form of the Map to the named file. The file is
+written under a temporary name and renamed into place, so readers
+never see a partially written map. Returns true on success.
+
 =back
 
 =head1 SEE ALSO
@@ -137,5 +215,33 @@ L<P4::Resolver>, L<P4::Spec>, L<P4::MergeData>, L<P4::Message>
 Copyright (c) 2008-2010, Perforce Software, Inc. All rights reserved.
 
 =cut
+
+sub Save {
+	my $self = shift;
+	my $file = shift;
+	my $tmp  = "$file.$$.tmp";
+
+	open( my $fh, ">", $tmp ) or return undef;
+	binmode( $fh );
+	unless( print $fh $self->Freeze() and close( $fh ) ) {
+		unlink( $tmp );
+		return undef;
+	}
+	return rename( $tmp, $file ) ? 1 : undef;
+}
+
+sub Load {
+	my $class = shift;
+	my $file  = shift;
+
+	open( my $fh, "<", $file ) or return undef;
+	binmode( $fh );
+	local $/;
+	my $data = <$fh>;
+	close( $fh );
+	return undef unless defined( $data );
+	return $class->Thaw( $data );
+}
+
 1;
 __END__
@@ -102,6 +102,36 @@ Returns a string containing the hint from Perforce's merge
 algorithm, indicating the recommended action for performing
 the resolve.
 
+=item YourChunks()
+
+Returns the number of chunks changed only in 'your' file.
+
+=item TheirChunks()
+
+Returns the number of chunks changed only in 'their' file.
+
+=item BothChunks()
+
+Returns the number of chunks changed identically in both files.
+
+=item ConflictChunks()
+
+Returns the number of conflicting chunks: those changed differently
+in both files. A merge with no conflicting chunks can be accepted
+as 'am' without editing.
+
+=item Stats()
+
+Returns a reference to a hash holding the four chunk counts above
+(C<YourChunks>, C<TheirChunks>, C<BothChunks>, C<ConflictChunks>)
+together with the number of lines in each of the merge files
+(C<YourLines>, C<TheirLines>, C<BaseLines>). The line counts are
+taken in C++ the first time Stats() is called, so resolvers can weigh
+the size of a conflict without reading the files themselves.
+
+    my $s = $mergeData->Stats();
+    return "at" if( $s->{ConflictChunks} * 10 < $s->{YourLines} );
+
 =item RunMergeTool()
 
 Runs the user's chosen merge tool (if any). Returns true if
@@ -108,6 +108,10 @@ method can return the following values to alter the Run behaviour:
 	2 = mark command for abort (add to output)
 	3 = mark command for abort (don't to output)
 
+Handlers that only count records, collect one field, filter on a field
+or write records to a file are better written with the P4::Handler
+classes, which do the same without a Perl call per record.
+
 =head1 METHODS
 
 =cut
@@ -235,7 +239,7 @@ sub OutputStat {
 
 =head1 SEE ALSO
 
-L<P4>, L<P4::Message>, L<P4::Progress>
+L<P4>, L<P4::Message>, L<P4::Progress>, L<P4::Handler>
 
 =head1 COPYRIGHT
 
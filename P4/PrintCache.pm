@@ -0,0 +1,366 @@
+#-------------------------------------------------------------------------------
+# Copyright (c) 2008-2026, Perforce Software, Inc.  All rights reserved.
+# 
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+# 
+# 1.  Redistributions of source code must retain the above copyright
+#     notice, this list of conditions and the following disclaimer.
+# 
+# 2.  Redistributions in binary form must reproduce the above copyright
+#     notice, this list of conditions and the following disclaimer in the
+#     documentation and/or other materials provided with the distribution.
+# 
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+# ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+# DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+# (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+# LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+# ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+# SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+package P4::PrintCache;
+
+=pod
+
+=head1 NAME
+
+P4::PrintCache
+
+=head1 SYNOPSIS
+
+    use P4;
+
+    $p4 = new P4;
+    $p4->SetPrintCache( new P4::PrintCache( "/var/cache/p4print",
+					     1024 * 1024 * 1024 ) );
+    $p4->Connect();
+    @r = $p4->RunPrint( "//depot/main/README#12" );
+
+=head1 DESCRIPTION
+
+A P4::PrintCache keeps a local copy of the content of file revisions
+printed with P4::Run( "print", ... ), so that printing the same
+revisions again is answered from disk without contacting the server.
+
+Only tagged 'print' commands with no flags, whose arguments are all
+single files in depot syntax with a specific revision number (e.g.
+C<//depot/main/README#12>) are considered, and only while no output
+handler is set. Anything else runs as usual.
+
+The first time a revision is printed, its digest is fetched with
+'fstat -Ol' before it is printed. The content is only cached if its
+MD5 matches the server's digest; this excludes files whose printed form
+differs from the archive, such as those with RCS keyword expansion, and
+these are always printed by the server. Content is stored once per
+digest, so identical revisions of different files share storage.
+
+Entries are keyed on the server port and user as well as the depot
+path, so a user is only served revisions that they have printed
+themselves. The content store itself may be shared.
+
+Files are published by writing to a temporary file and renaming it
+into place, so several processes can safely share one cache
+directory. When the content exceeds its size limit, the least recently
+used revisions are removed.
+
+On a cache hit, the content of each file is returned as a single
+string following its tagged header, rather than in the chunks in which
+the server sends it.
+
+=head1 CLASS METHODS
+
+=over
+
+=item new( $dir [, $maxBytes ] )
+
+Constructs a new P4::PrintCache storing its files under $dir, which
+is created if need be. The content kept is limited to $maxBytes,
+which defaults to 256MB. Returns undef if the directory can't be
+created.
+
+=back
+
+=head1 OBJECT METHODS
+
+=over
+
+=item Stats()
+
+Returns a reference to a hash containing the number of Hits, Misses
+and Stores made through this object, and the Bytes of content in the
+cache.
+
+=item Clear()
+
+Removes all of the cached content and index entries.
+
+=back
+
+=head1 SEE ALSO
+
+L<P4>
+
+=cut
+
+use strict;
+use Digest::MD5;
+
+sub new {
+	my $proto = shift;
+	my $class = ref($proto) || $proto;
+	my $dir   = shift;
+	my $limit = shift || 256 * 1024 * 1024;
+
+	foreach my $d ( $dir, "$dir/objects", "$dir/index", "$dir/tmp" ) {
+		mkdir( $d ) or -d $d or return undef;
+	}
+
+	my $self = {
+		dir    => $dir,
+		limit  => $limit,
+		bytes  => undef,
+		hits   => 0,
+		misses => 0,
+		stores => 0,
+	};
+	return bless( $self, $class );
+}
+
+sub Stats {
+	my $self = shift;
+	return {
+		Hits   => $self->{hits},
+		Misses => $self->{misses},
+		Stores => $self->{stores},
+		Bytes  => $self->_Bytes(),
+	};
+}
+
+sub Clear {
+	my $self = shift;
+	foreach my $f ( $self->_Objects(), glob( "$self->{dir}/index/*" ) ) {
+		unlink( ref($f) ? $f->[0] : $f );
+	}
+	$self->{bytes} = 0;
+}
+
+#
+# Called by P4::Run for 'print' commands. Returns an array ref of results,
+# or undef if the command isn't one we can handle, in which case the
+# caller runs it as usual.
+#
+sub Run {
+	my $self = shift;
+	my $p4   = shift;
+	my @args = @_;
+
+	return undef unless ( @args && $p4->IsTagged() );
+	foreach my $f (@args) {
+		return undef unless ( $f =~ m{^//[^#@*,]+#[1-9]\d*$} );
+		return undef if ( $f =~ m{\.\.\.|%%} );
+	}
+
+	# Try the cache first; we only serve hits if every file is present.
+	my $ident = join( "\0", $p4->GetPort(), $p4->GetUser() );
+	my @out;
+	my @miss;
+	foreach my $f (@args) {
+		my $entry = $self->_Lookup( $ident, $f );
+		if ($entry) {
+			push( @out, @$entry );
+		}
+		else {
+			push( @miss, $f );
+		}
+	}
+
+	unless (@miss) {
+		$self->{hits}++;
+		$p4->_ResetResults();
+		return \@out;
+	}
+	$self->{misses}++;
+
+	# Fetch the digests of the revisions we don't have. The print comes
+	# last so that the caller sees its errors and warnings, not ours.
+	my %digest;
+	my $fstat = $p4->_Run( "fstat", "-Ol", @miss );
+	if ( !$p4->ErrorCount() ) {
+		foreach my $r (@$fstat) {
+			next unless ( ref($r) && $r->{digest} && $r->{headRev} );
+			$digest{ $r->{depotFile} . "#" . $r->{headRev} } = $r->{digest};
+		}
+	}
+
+	my $results = $p4->_Run( "print", @args );
+	return $results if ( $p4->ErrorCount() || $p4->WarningCount() );
+
+	# Split the output into a header and content for each file
+	my $header;
+	my $content;
+	foreach my $r ( @$results, undef ) {
+		if ( !defined($r) || ref($r) ) {
+			if ($header) {
+				my $key = $header->{depotFile} . "#" . $header->{rev};
+				$self->_Store( $ident, $key, $header, $content, $digest{$key} )
+				  if ( $digest{$key} );
+			}
+			$header  = $r;
+			$content = "";
+		}
+		else {
+			$content .= $r;
+		}
+	}
+	return $results;
+}
+
+#
+# The index file for a revision holds the print header and the digest of
+# its content as "key value" lines.
+#
+sub _IndexFile {
+	my $self  = shift;
+	my $ident = shift;
+	my $rev   = shift;
+	return "$self->{dir}/index/" . Digest::MD5::md5_hex("$ident\0$rev");
+}
+
+sub _ObjectFile {
+	my $self   = shift;
+	my $digest = uc(shift);
+	return "$self->{dir}/objects/$digest";
+}
+
+sub _Lookup {
+	my $self  = shift;
+	my $ident = shift;
+	my $rev   = shift;
+
+	open( my $fh, "<", $self->_IndexFile( $ident, $rev ) ) or return undef;
+	my %header;
+	while ( my $line = <$fh> ) {
+		chomp($line);
+		my ( $k, $v ) = split( / /, $line, 2 );
+		$header{$k} = $v;
+	}
+	close($fh);
+
+	my $digest = delete( $header{'.digest'} ) or return undef;
+	my $obj = $self->_ObjectFile($digest);
+	open( $fh, "<", $obj ) or return undef;
+	binmode($fh);
+	local $/;
+	my $content = <$fh>;
+	close($fh);
+	return undef unless defined($content);
+
+	# Mark the content as recently used for eviction
+	my $now = time();
+	utime( $now, $now, $obj );
+
+	return [ \%header, $content ];
+}
+
+sub _Store {
+	my $self    = shift;
+	my $ident   = shift;
+	my $rev     = shift;
+	my $header  = shift;
+	my $content = shift;
+	my $digest  = uc(shift);
+
+	return unless ( uc( Digest::MD5::md5_hex($content) ) eq $digest );
+	return if ( length($content) > $self->{limit} );
+
+	my $obj = $self->_ObjectFile($digest);
+	unless ( -e $obj ) {
+		$self->_Publish( $obj, $content ) or return;
+		$self->_Evict( length($content) );
+	}
+
+	my $index = "";
+	foreach my $k ( sort keys %$header ) {
+		my $v = $header->{$k};
+		next if ( $v =~ /\n/ );
+		$index .= "$k $v\n";
+	}
+	$index .= ".digest $digest\n";
+	$self->_Publish( $self->_IndexFile( $ident, $rev ), $index ) or return;
+	$self->{stores}++;
+}
+
+#
+# Write the data to a temporary file, then rename it into place so that
+# readers never see a partial file.
+#
+sub _Publish {
+	my $self = shift;
+	my $file = shift;
+	my $data = shift;
+	my $tmp  = "$self->{dir}/tmp/$$." . ++$self->{serial};
+
+	open( my $fh, ">", $tmp ) or return undef;
+	binmode($fh);
+	unless ( print $fh $data and close($fh) ) {
+		unlink($tmp);
+		return undef;
+	}
+	unless ( rename( $tmp, $file ) ) {
+		unlink($tmp);
+		return undef;
+	}
+	return 1;
+}
+
+# Returns [ path, size, mtime ] for every object in the cache
+sub _Objects {
+	my $self = shift;
+	my @objects;
+
+	opendir( my $dh, "$self->{dir}/objects" ) or return ();
+	foreach my $f ( readdir($dh) ) {
+		next if ( $f =~ /^\./ );
+		my $path = "$self->{dir}/objects/$f";
+		my @st   = stat($path) or next;
+		push( @objects, [ $path, $st[7], $st[9] ] );
+	}
+	closedir($dh);
+	return @objects;
+}
+
+sub _Bytes {
+	my $self  = shift;
+	my $bytes = 0;
+	$bytes += $_->[1] foreach ( $self->_Objects() );
+	return $self->{bytes} = $bytes;
+}
+
+#
+# Called after adding an object of the given size. The running total is
+# only an estimate when other processes share the cache, so it's
+# recalculated from the directory whenever it appears to be over the
+# limit, and before evicting anything.
+#
+sub _Evict {
+	my $self  = shift;
+	my $added = shift;
+
+	$self->{bytes} = defined( $self->{bytes} ) ? $self->{bytes} + $added : $self->_Bytes();
+	return if ( $self->{bytes} <= $self->{limit} );
+
+	my @objects = sort { $a->[2] <=> $b->[2] } $self->_Objects();
+	my $bytes = 0;
+	$bytes += $_->[1] foreach (@objects);
+
+	while ( $bytes > $self->{limit} && @objects ) {
+		my $o = shift(@objects);
+		$bytes -= $o->[1] if ( unlink( $o->[0] ) );
+	}
+	$self->{bytes} = $bytes;
+}
+
+1;
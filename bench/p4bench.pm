@@ -0,0 +1,300 @@
+#-------------------------------------------------------------------------------
+# Support class for the P4Perl benchmarks. Builds on P4::Test (t/p4test.pm)
+# to run against a local rsh:p4d server seeded with synthetic data, times
+# workloads and records the results as JSON.
+#-------------------------------------------------------------------------------
+
+package P4::Bench;
+use strict;
+use Cwd;
+use File::Path;
+use JSON::PP;
+use Time::HiRes qw( time );
+use P4;
+
+BEGIN {
+    unshift( @INC, "t" );
+    require "p4test.pm";
+}
+
+our @ISA = qw( P4::Test );
+
+# Keep well away from the tests' server root
+$P4::Test::ROOT_DIR = "benchroot";
+
+sub new
+{
+    my $class = shift;
+    my %args  = @_;
+    my $self  = P4::Test::new( $class );
+
+    $self->{ 'results' } = {};
+    $self->{ 'meta' } = {
+	perl	=> sprintf( "%vd", $^V ),
+	p4perl	=> $P4::VERSION,
+	os	=> $^O,
+	started	=> time(),
+	%args,
+    };
+    return $self;
+}
+
+#
+# Create a fresh server and workspace. Returns a connected P4 object.
+#
+sub Setup
+{
+    my $self = shift;
+
+    $self->CreateTestTree();
+    $self->EnableUnicode() if( $self->{ 'meta' }->{ 'unicode' } );
+    my $p4 = $self->InitClient();
+    $p4->SetProg( "p4perl-bench" );
+    $p4->SetCharset( "utf8" ) if( $self->{ 'meta' }->{ 'unicode' } );
+    $p4->Connect() or die( "Can't connect to benchmark server" );
+
+    my $client = $p4->FetchClient();
+    $client->{ 'Root' } = $self->ClientRoot();
+    $client->{ 'Description' } = "P4Perl benchmark workspace";
+    $p4->SaveClient( $client );
+
+    my @info = $p4->RunInfo();
+    $self->{ 'meta' }->{ 'server' } = $info[0]->{ 'serverVersion' };
+    return $p4;
+}
+
+#
+# Re-use an existing seeded server. Returns a connected P4 object.
+#
+sub Reuse
+{
+    my $self = shift;
+
+    die( "No existing benchmark server to reuse" ) 
+	unless -d $self->ServerRoot();
+
+    my $p4 = $self->InitClient();
+    $p4->SetProg( "p4perl-bench" );
+    $p4->SetCharset( "utf8" ) if( $self->{ 'meta' }->{ 'unicode' } );
+    $p4->Connect() or die( "Can't connect to benchmark server" );
+    $p4->SetPassword( $P4::Test::SUPER_PASSWORD );
+    $p4->RunLogin();
+    return $p4;
+}
+
+#
+# Seed $count files of $size bytes under //depot/bench/..., 1000 to a
+# directory, submitting in batches to keep changelists a sensible size.
+#
+sub SeedFiles
+{
+    my $self  = shift;
+    my $p4    = shift;
+    my $count = shift;
+    my $size  = shift || 512;
+    my $batch = 10000;
+    my $line  = "P4Perl benchmark data line\n";
+    my $body  = $line x int( $size / length( $line ) + 1 );
+
+    $body = substr( $body, 0, $size );
+
+    for( my $start = 0; $start < $count; $start += $batch )
+    {
+	my $end = $start + $batch;
+	$end = $count if $end > $count;
+
+	for( my $i = $start; $i < $end; $i++ )
+	{
+	    my $dir = sprintf( "bench/d%04d", int( $i / 1000 ) );
+	    mkpath( $dir ) unless -d $dir;
+	    my $path = sprintf( "%s/f%06d.txt", $dir, $i );
+	    open( my $fh, ">", $path ) or die( "Can't create $path" );
+	    print $fh $body;
+	    close( $fh );
+	}
+	$p4->RunAdd( "bench/..." );
+	$p4->RunSubmit( "-d", "Seed files $start to $end" );
+	die( "Seeding failed: " . join( "\n", $p4->Errors() ) )
+	    if $p4->ErrorCount();
+    }
+}
+
+#
+# Seed $count files with non-ASCII names and content under
+# //depot/unicode/... on a unicode server.
+#
+sub SeedUnicode
+{
+    my $self  = shift;
+    my $p4    = shift;
+    my $count = shift;
+    my $body  = "Gr\xc3\xbc\xc3\x9fe aus K\xc3\xb6ln, \xe6\x97\xa5\xe6\x9c\xac\n" x 8;
+
+    mkpath( "unicode" );
+    for( my $i = 0; $i < $count; $i++ )
+    {
+	my $path = sprintf( "unicode/caf\xc3\xa9-%06d.txt", $i );
+	open( my $fh, ">", $path ) or die( "Can't create $path" );
+	print $fh $body;
+	close( $fh );
+    }
+    $p4->RunAdd( "unicode/..." );
+    $p4->RunSubmit( "-d", "Seed unicode files: \xc3\xa9\xc3\xa8\xc3\xaa" );
+    die( "Seeding failed: " . join( "\n", $p4->Errors() ) )
+	if $p4->ErrorCount();
+}
+
+#
+# Give one file a deep history of $revs revisions.
+#
+sub SeedHistory
+{
+    my $self = shift;
+    my $p4   = shift;
+    my $revs = shift;
+    my $path = "history/deep.txt";
+
+    mkpath( "history" );
+    open( my $fh, ">", $path ) or die( "Can't create $path" );
+    print $fh "revision 1\n";
+    close( $fh );
+    $p4->RunAdd( $path );
+    $p4->RunSubmit( "-d", "Add deep history file" );
+
+    for( my $r = 2; $r <= $revs; $r++ )
+    {
+	$p4->RunEdit( $path );
+	open( $fh, ">>", $path ) or die( "Can't append to $path" );
+	print $fh "revision $r\n";
+	close( $fh );
+	$p4->RunSubmit( "-d", "Revision $r of deep history file" );
+    }
+    return "//depot/history/deep.txt";
+}
+
+#
+# Create $count jobs.
+#
+sub SeedJobs
+{
+    my $self  = shift;
+    my $p4    = shift;
+    my $count = shift;
+
+    for( my $i = 0; $i < $count; $i++ )
+    {
+	my $job = $p4->FetchJob();
+	$job->{ 'Job' } = sprintf( "bench%06d", $i );
+	$job->{ 'Description' } = "Benchmark job $i\n" . ( "detail " x 20 );
+	$p4->SaveJob( $job );
+    }
+}
+
+#
+# Time a workload. The sub is called $iterations times and must return
+# the number of records it processed. Records throughput, the process's
+# peak RSS and the growth in RSS per record across the workload.
+#
+sub Measure
+{
+    my $self	   = shift;
+    my $name	   = shift;
+    my $iterations = shift;
+    my $code	   = shift;
+    my $records	   = 0;
+
+    my $rss0  = RSS();
+    my $start = time();
+    for( my $i = 0; $i < $iterations; $i++ )
+    {
+	$records += $code->();
+    }
+    my $elapsed = time() - $start;
+    my $rss1  = RSS();
+
+    my $r = {
+	records		=> $records,
+	seconds		=> $elapsed,
+	records_per_sec	=> $elapsed > 0 ? $records / $elapsed : 0,
+	peak_rss_kb	=> PeakRSS(),
+    };
+    if( defined( $rss0 ) && defined( $rss1 ) && $records )
+    {
+	$r->{ 'rss_growth_kb' } = $rss1 - $rss0;
+	$r->{ 'bytes_per_record' } = ( $rss1 - $rss0 ) * 1024 / $records;
+    }
+
+    $self->{ 'results' }->{ $name } = $r;
+    printf( "%-24s %10d recs %9.3fs %12.1f recs/s  peak %s KB\n",
+	    $name, $records, $elapsed, $r->{ 'records_per_sec' }, 
+	    defined( $r->{ 'peak_rss_kb' } ) ? $r->{ 'peak_rss_kb' } : "?" );
+    return $r;
+}
+
+#
+# Write the results as JSON.
+#
+sub Write
+{
+    my $self = shift;
+    my $file = shift;
+
+    $self->{ 'meta' }->{ 'finished' } = time();
+    my $json = JSON::PP->new->pretty->canonical;
+    open( my $fh, ">", $file ) or die( "Can't write $file" );
+    print $fh $json->encode( { meta	   => $self->{ 'meta' },
+			       results => $self->{ 'results' } } );
+    close( $fh );
+}
+
+#
+# Compare throughput against a previous results file. Returns the names
+# of the workloads that are slower than the baseline by more than
+# $tolerance percent.
+#
+sub Compare
+{
+    my $self	  = shift;
+    my $file	  = shift;
+    my $tolerance = shift;
+    my @slower;
+
+    open( my $fh, "<", $file ) or die( "Can't read baseline $file" );
+    local $/;
+    my $base = decode_json( <$fh> );
+    close( $fh );
+
+    printf( "\n%-24s %14s %14s %8s\n", "workload", "baseline/s", "now/s", "change" );
+    foreach my $name ( sort keys %{ $self->{ 'results' } } )
+    {
+	my $b = $base->{ 'results' }->{ $name } or next;
+	my $now  = $self->{ 'results' }->{ $name }->{ 'records_per_sec' };
+	my $then = $b->{ 'records_per_sec' };
+	next unless $then;
+
+	my $change = ( $now - $then ) * 100 / $then;
+	printf( "%-24s %14.1f %14.1f %+7.1f%%\n", $name, $then, $now, $change );
+	push( @slower, $name ) if $change < -$tolerance;
+    }
+    return @slower;
+}
+
+#
+# Memory figures, from /proc where available. Undefined elsewhere.
+#
+sub ProcStatus
+{
+    my $field = shift;
+
+    open( my $fh, "<", "/proc/$$/status" ) or return undef;
+    while( <$fh> )
+    {
+	return $1 if /^$field:\s+(\d+)\s+kB/;
+    }
+    return undef;
+}
+
+sub RSS	    { return ProcStatus( "VmRSS" ) }
+sub PeakRSS { return ProcStatus( "VmHWM" ) }
+
+1;
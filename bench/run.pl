@@ -0,0 +1,211 @@
+#-------------------------------------------------------------------------------
+# P4Perl throughput benchmarks.
+#
+# Seeds a local rsh:p4d server with synthetic data and measures the rate
+# at which P4Perl turns server output into Perl data for the commonly
+# used commands, plus the spec and map classes. Run with 'make bench', or
+# directly with:
+#
+#   perl -Mblib bench/run.pl [options]
+#
+# Options:
+#   --files N	     number of files to seed (default 1000)
+#   --revs N	     revisions in the deep filelog (default 100)
+#   --jobs N	     number of jobs to seed (default 1000)
+#   --iterations N   times to repeat each workload (default 3)
+#   --only REGEX     run only the workloads whose names match
+#   --reuse	     reuse the server seeded by a previous run
+#   --unicode	     use a unicode server, and add the UTF-8 output
+#		     workloads (run in a separate server root)
+#   --output FILE    where to write the JSON results (default bench.json)
+#   --baseline FILE  compare throughput with an earlier results file
+#   --tolerance PCT  allowed slowdown against the baseline (default 10)
+#
+# Exits non-zero if any workload is slower than the baseline allows.
+#-------------------------------------------------------------------------------
+
+use strict;
+use Getopt::Long;
+use Encode;
+use File::Spec;
+use lib ".", "bench";
+use P4;
+require "p4bench.pm";
+
+my %opt = (
+    files	=> 1000,
+    revs	=> 100,
+    jobs	=> 1000,
+    iterations	=> 3,
+    output	=> "bench.json",
+    tolerance	=> 10,
+);
+GetOptions( \%opt, "files=i", "revs=i", "jobs=i", "iterations=i", 
+	    "only=s", "reuse", "unicode", "output=s", "baseline=s", 
+	    "tolerance=f" )
+    or die( "Usage: $0 [options]\n" );
+
+$P4::Test::ROOT_DIR = "benchroot-unicode" if( $opt{ 'unicode' } );
+my $bench = new P4::Bench( files => $opt{ 'files' }, revs => $opt{ 'revs' },
+			   jobs => $opt{ 'jobs' }, 
+			   unicode => $opt{ 'unicode' } ? 1 : 0 );
+my $p4;
+my $deep = "//depot/history/deep.txt";
+
+if( $opt{ 'reuse' } )
+{
+    $p4 = $bench->Reuse();
+}
+else
+{
+    $p4 = $bench->Setup();
+    print( "Seeding $opt{ 'files' } files, $opt{ 'revs' } revisions, " .
+	   "$opt{ 'jobs' } jobs...\n" );
+    $bench->SeedFiles( $p4, $opt{ 'files' } );
+    $deep = $bench->SeedHistory( $p4, $opt{ 'revs' } );
+    $bench->SeedJobs( $p4, $opt{ 'jobs' } );
+    $bench->SeedUnicode( $p4, $opt{ 'files' } ) if( $opt{ 'unicode' } );
+}
+
+my @changes = $p4->RunChanges( "-m1", "//depot/bench/..." );
+my $change = $changes[0]->{ 'change' };
+my @paths = map { $_->{ 'depotFile' } } $p4->RunFiles( "//depot/bench/..." );
+my $n = $opt{ 'iterations' };
+
+my %workloads = (
+    fstat	=> sub { scalar( @{ $p4->RunFstat( "//depot/bench/..." ) } ) },
+    files	=> sub { scalar( @{ $p4->RunFiles( "//depot/bench/..." ) } ) },
+    filelog	=> sub {
+	my $r = $p4->RunFilelog( $deep );
+	scalar( @{ $r->[0]->Revisions() } );
+    },
+    print	=> sub { scalar( @{ $p4->RunPrint( "//depot/bench/..." ) } ) },
+    jobs	=> sub { scalar( @{ $p4->RunJobs() } ) },
+    describe	=> sub {
+	my $r = $p4->RunDescribe( "-s", $change );
+	scalar( @{ $r->[0]->{ 'depotFile' } || [] } );
+    },
+    spec_parse	=> sub {
+	my $form = $p4->FormatClient( $p4->FetchClient() );
+	$p4->ParseClient( $form ) for 1 .. 1000;
+	1000;
+    },
+    spec_format	=> sub {
+	my $client = $p4->FetchClient();
+	$p4->FormatClient( $client ) for 1 .. 1000;
+	1000;
+    },
+    map_translate => sub {
+	my $map = new P4::Map( [ "//depot/bench/... //ws/bench/..." ] );
+	$map->Translate( $_ ) for @paths;
+	scalar( @paths );
+    },
+    map_translate_array => sub {
+	my $map = new P4::Map( [ "//depot/bench/... //ws/bench/..." ] );
+	scalar( @{ $map->TranslateArray( \@paths ) } );
+    },
+    map_includes => sub {
+	my $map = new P4::Map( [ map { "//depot/bench/d$_/... //ws/d$_/..." } 
+				 1 .. 2000 ] );
+	$map->Compile();
+	scalar( @{ $map->IncludesArray( \@paths ) } );
+    },
+);
+
+#
+# Getting character strings out of a unicode server: decoding byte strings
+# in Perl, as callers had to, against having P4Perl flag them as UTF-8.
+#
+sub utf8_fstat
+{
+    my $mode   = shift;
+    my $decode = shift;
+
+    $p4->SetOutputUtf8( $mode );
+    my $r = $p4->RunFstat( "//depot/unicode/..." );
+    $p4->SetOutputUtf8( 0 );
+    if( $decode )
+    {
+	foreach my $h ( @$r )
+	{
+	    ref( $_ ) or $_ = Encode::decode_utf8( $_ ) for values %$h;
+	}
+    }
+    return scalar( @$r );
+}
+
+sub utf8_print
+{
+    my $mode   = shift;
+    my $decode = shift;
+
+    $p4->SetOutputUtf8( $mode );
+    my $r = $p4->RunPrint( "//depot/unicode/..." );
+    $p4->SetOutputUtf8( 0 );
+    if( $decode )
+    {
+	ref( $_ ) or $_ = Encode::decode_utf8( $_ ) for @$r;
+    }
+    return scalar( @$r );
+}
+
+#
+# Exporting tagged output as JSON lines: a hash per record encoded in
+# Perl, against the native writer. Both write to the null device.
+#
+my $null = File::Spec->devnull();
+my $json = eval { require JSON::XS; JSON::XS->new } || JSON::PP->new;
+
+sub export_perl
+{
+    my $r = $p4->Run( @_ );
+    open( my $fh, ">", $null ) or die( "Can't write $null" );
+    print $fh $json->encode( $_ ), "\n" for @$r;
+    close( $fh );
+    return scalar( @$r );
+}
+
+sub export_native
+{
+    open( my $fh, ">", $null ) or die( "Can't write $null" );
+    my $h = new P4::Handler::ToFile( $fh, "json" );
+    $p4->SetHandler( $h );
+    $p4->Run( @_ );
+    close( $fh );
+    return $h->Count();
+}
+
+$workloads{ 'export_fstat_perl' }	= sub { export_perl( "fstat", "//depot/bench/..." ) };
+$workloads{ 'export_fstat_native' }	= sub { export_native( "fstat", "//depot/bench/..." ) };
+$workloads{ 'export_changes_perl' }	= sub { export_perl( "changes", "-l" ) };
+$workloads{ 'export_changes_native' }	= sub { export_native( "changes", "-l" ) };
+
+if( $opt{ 'unicode' } )
+{
+    $workloads{ 'utf8_fstat_decode' }	= sub { utf8_fstat( 0, 1 ) };
+    $workloads{ 'utf8_fstat_flagged' }	= sub { utf8_fstat( 1, 0 ) };
+    $workloads{ 'utf8_fstat_validated' }	= sub { utf8_fstat( 2, 0 ) };
+    $workloads{ 'utf8_print_decode' }	= sub { utf8_print( 0, 1 ) };
+    $workloads{ 'utf8_print_flagged' }	= sub { utf8_print( 1, 0 ) };
+    $workloads{ 'utf8_print_validated' }	= sub { utf8_print( 2, 0 ) };
+}
+
+foreach my $name ( sort keys %workloads )
+{
+    next if( defined( $opt{ 'only' } ) && $name !~ /$opt{ 'only' }/ );
+    $bench->Measure( $name, $n, $workloads{ $name } );
+}
+
+$p4->Disconnect();
+$bench->Write( $opt{ 'output' } );
+print( "\nResults written to $opt{ 'output' }\n" );
+
+if( $opt{ 'baseline' } )
+{
+    my @slower = $bench->Compare( $opt{ 'baseline' }, $opt{ 'tolerance' } );
+    if( @slower )
+    {
+	print( "\nSlower than baseline: @slower\n" );
+	exit( 1 );
+    }
+}
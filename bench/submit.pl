@@ -0,0 +1,88 @@
+#-------------------------------------------------------------------------------
+# P4Perl parallel submit benchmark.
+#
+# Seeds a local rsh:p4d server with large binary files and times submitting
+# them over a single connection and over several. Run with 
+# 'make bench-submit', or directly with:
+#
+#   perl -Mblib bench/submit.pl [options]
+#
+# Options:
+#   --files N	     number of files to submit (default 200)
+#   --size KB	     size of each file in KB (default 4096)
+#   --threads LIST   thread counts to compare (default 1,2,4,8)
+#   --batch N	     files per batch for parallel submits (default 8)
+#   --iterations N   times to submit at each thread count (default 1)
+#   --output FILE    where to write the JSON results (default bench-submit.json)
+#
+# Each iteration opens every file for edit and submits it, so the times
+# include the edit; that's small next to the transfer. Throughput is in
+# files per second; multiply by --size for KB per second.
+#-------------------------------------------------------------------------------
+
+use strict;
+use Getopt::Long;
+use File::Path;
+use lib ".", "bench";
+use P4;
+require "p4bench.pm";
+
+my %opt = (
+    files	=> 200,
+    size	=> 4096,
+    threads	=> "1,2,4,8",
+    batch	=> 8,
+    iterations	=> 1,
+    output	=> "bench-submit.json",
+);
+GetOptions( \%opt, "files=i", "size=i", "threads=s", "batch=i",
+	    "iterations=i", "output=s" )
+    or die( "Usage: $0 [options]\n" );
+
+my @threads = sort { $a <=> $b } split( /,/, $opt{ 'threads' } );
+
+$P4::Test::ROOT_DIR = "benchroot-submit";
+my $bench = new P4::Bench( files => $opt{ 'files' }, size_kb => $opt{ 'size' },
+			   threads => $opt{ 'threads' }, 
+			   batch => $opt{ 'batch' } );
+my $p4 = $bench->Setup();
+$p4->RunConfigure( "set", "net.parallel.max=" . ( $threads[-1] > 1 ? $threads[-1] : 2 ) );
+
+#
+# Incompressible content, so the server's compression doesn't flatter
+# either side. Each file gets its own header so none are identical.
+#
+print( "Seeding $opt{ 'files' } files of $opt{ 'size' } KB...\n" );
+srand( 42 );
+my $block = pack( "L*", map { int( rand( 2**32 ) ) } 1 .. 16384 );
+my $body = $block x int( $opt{ 'size' } * 1024 / length( $block ) + 1 );
+$body = substr( $body, 0, $opt{ 'size' } * 1024 );
+
+mkpath( "submit" );
+for( my $i = 0; $i < $opt{ 'files' }; $i++ )
+{
+    my $path = sprintf( "submit/f%06d.bin", $i );
+    open( my $fh, ">", $path ) or die( "Can't create $path" );
+    binmode( $fh );
+    print $fh sprintf( "%08d", $i ), substr( $body, 8 );
+    close( $fh );
+}
+$p4->RunAdd( "-t", "binary", "submit/..." );
+$p4->RunSubmit( "-d", "Seed submit benchmark files" );
+die( "Seeding failed: " . join( "\n", $p4->Errors() ) ) if $p4->ErrorCount();
+
+foreach my $t ( @threads )
+{
+    $bench->Measure( "submit_threads_$t", $opt{ 'iterations' }, sub {
+	$p4->SetParallelSubmit( $t > 1 ? $t : 0, $opt{ 'batch' }, 1, 1 );
+	$p4->RunEdit( "submit/..." );
+	$p4->RunSubmit( "-d", "Submit over $t connection(s)" );
+	die( "Submit failed: " . join( "\n", $p4->Errors() ) ) 
+	    if $p4->ErrorCount();
+	$opt{ 'files' };
+    } );
+}
+
+$p4->Disconnect();
+$bench->Write( $opt{ 'output' } );
+print( "\nResults written to $opt{ 'output' }\n" );
@@ -0,0 +1,72 @@
+#-------------------------------------------------------------------------------
+# P4Perl sync IO policy benchmark.
+#
+# Seeds a local rsh:p4d server with a tree of small files and times 
+# 'sync -f' of the tree under different sync IO policies. Run with 
+# 'make bench-syncio', or directly with:
+#
+#   perl -Mblib bench/syncio.pl [options]
+#
+# Options:
+#   --files N	     number of files to seed (default 20000)
+#   --size BYTES     size of each file (default 1024)
+#   --iterations N   times to sync under each policy (default 3)
+#   --root DIR	     where to put the server and workspace, e.g. on the
+#		     network filesystem of interest (default benchroot-syncio)
+#   --only REGEX     run only the policies whose names match
+#   --output FILE    where to write the JSON results (default bench-syncio.json)
+#
+# The fsync_* policies make every file durable, which the default doesn't,
+# so compare them with each other: fsync_each is the cost of an fsync per
+# file, fsync_grouped what deferring and grouping them saves.
+#-------------------------------------------------------------------------------
+
+use strict;
+use Getopt::Long;
+use lib ".", "bench";
+use P4;
+require "p4bench.pm";
+
+my %opt = (
+    files	=> 20000,
+    size	=> 1024,
+    iterations	=> 3,
+    root	=> "benchroot-syncio",
+    output	=> "bench-syncio.json",
+);
+GetOptions( \%opt, "files=i", "size=i", "iterations=i", "root=s", "only=s",
+	    "output=s" )
+    or die( "Usage: $0 [options]\n" );
+
+$P4::Test::ROOT_DIR = $opt{ 'root' };
+my $bench = new P4::Bench( files => $opt{ 'files' }, size => $opt{ 'size' } );
+my $p4 = $bench->Setup();
+
+print( "Seeding $opt{ 'files' } files of $opt{ 'size' } bytes...\n" );
+$bench->SeedFiles( $p4, $opt{ 'files' }, $opt{ 'size' } );
+
+my %policies = (
+    default		=> undef,
+    buffered		=> { buffer => 1024 * 1024, presize => 1 },
+    fsync_each		=> { fsync => 1 },
+    fsync_grouped	=> { buffer => 1024 * 1024, presize => 1, 
+			     fsync => 512 },
+);
+
+foreach my $name ( sort keys %policies )
+{
+    next if( defined( $opt{ 'only' } ) && $name !~ /$opt{ 'only' }/ );
+
+    $p4->SetSyncIOPolicy( $policies{ $name } );
+    $bench->Measure( "sync_$name", $opt{ 'iterations' }, sub {
+	$p4->RunSync( "-f", "//depot/bench/..." );
+	die( "Sync failed: " . join( "\n", $p4->Errors() ) ) 
+	    if $p4->ErrorCount();
+	$opt{ 'files' };
+    } );
+}
+$p4->SetSyncIOPolicy( undef );
+
+$p4->Disconnect();
+$bench->Write( $opt{ 'output' } );
+print( "\nResults written to $opt{ 'output' }\n" );
@@ -41,15 +41,37 @@
 #include "p4result.h"
 #include "p4perldebug.h"
 #include "clientprog.h"
+#include "p4perltimer.h"
+#include "p4progressstats.h"
 #include "p4clientprogress.h"
 
-P4ClientProgress::P4ClientProgress(SV * prog, int type) {
+/*
+ * Progress is reported to a Perl P4::Progress object, to a native
+ * P4ProgressStats record, or both. Either may be null.
+ */
+P4ClientProgress::P4ClientProgress(SV * prog, int type, P4ProgressStats * s) {
 	debug = 0;
 	progress = prog;
+	stats = s;
+	this->type = type;
+
+	minInterval = 0;
+	minDelta = 0;
+	total = 0;
+	lastSent = 0;
+	pending = 0;
+	havePending = 0;
+	sentAny = 0;
+	lastTime = 0;
 
 	Init(type);
 }
 
+void P4ClientProgress::SetRate(int interval, long delta) {
+	minInterval = interval > 0 ? interval : 0;
+	minDelta = delta > 0 ? delta : 0;
+}
+
 P4ClientProgress::~P4ClientProgress() {
 
 }
@@ -58,6 +80,11 @@ void P4ClientProgress::Init(int type) {
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[P4ClientProgress::Init]: %d\n", type);
 
+	if (stats)
+		stats->Init(type);
+	if (!progress)
+		return;
+
 	// Nasty perl stuff to call 'method' on the 'iterator' class passing 'data'
 	dSP;
 
@@ -83,6 +110,11 @@ void P4ClientProgress::Description(const StrPtr *desc, int units) {
 		PerlIO_stdoutf("[P4ClientProgress::Description]: %s, %d\n",
 				desc->Text(), units);
 
+	if (stats)
+		stats->Description(type, desc, units);
+	if (!progress)
+		return;
+
 	// Nasty perl stuff to call 'method' on the 'iterator' class passing 'data'
 	dSP;
 
@@ -107,6 +139,13 @@ void P4ClientProgress::Total(long total) {
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[P4ClientProgress::Total]: %ld\n", total);
 
+	this->total = total;
+
+	if (stats)
+		stats->Total(type, total);
+	if (!progress)
+		return;
+
 	// Nasty perl stuff to call 'method' on the 'iterator' class passing 'data'
 	dSP;
 
@@ -126,9 +165,44 @@ void P4ClientProgress::Total(long total) {
 	LEAVE;
 }
 
+/*
+ * Updates are coalesced here, before we go anywhere near Perl. An update
+ * is suppressed if it arrives too soon after, or too close to, the last
+ * one delivered; except that the first update and one that reaches the
+ * total are always delivered. A suppressed update is remembered so Done()
+ * can deliver the final position before reporting completion.
+ */
 int P4ClientProgress::Update(long update) {
+	if (stats)
+		stats->Update(type, update);
+	if (!progress)
+		return 0;
+
+	if (minInterval || minDelta) {
+		double now = P4PerlTimer::Now();
+		int isFinal = total > 0 && update >= total;
+
+		if (sentAny && !isFinal) {
+			if ((minInterval && (now - lastTime) * 1000 < minInterval)
+					|| (minDelta && labs(update - lastSent) < minDelta)) {
+				pending = update;
+				havePending = 1;
+				return 0;
+			}
+		}
+		lastTime = now;
+	}
+
+	return CallUpdate(update);
+}
+
+int P4ClientProgress::CallUpdate(long update) {
 	int position = 0;
 
+	sentAny = 1;
+	lastSent = update;
+	havePending = 0;
+
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[P4ClientProgress:Update]: %ld\n", update);
 
@@ -160,6 +234,14 @@ int P4ClientProgress::Update(long update) {
 }
 
 void P4ClientProgress::Done(int fail) {
+	if (stats)
+		stats->Done(type, fail);
+	if (!progress)
+		return;
+
+	if (havePending)
+		CallUpdate(pending);
+
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[P4ClientProgress::Done]: %d\n", fail);
 
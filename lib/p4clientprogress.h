@@ -36,11 +36,18 @@
  *
  ******************************************************************************/
 
+class P4ProgressStats;
+
 class P4ClientProgress : public ClientProgress {
 public:
-	P4ClientProgress(SV * prog, int type);
+	P4ClientProgress(SV * prog, int type, P4ProgressStats * stats = 0);
 	virtual ~P4ClientProgress();
 
+	// Coalesce updates: only pass an update on to Perl if at least
+	// 'interval' milliseconds and 'delta' units have passed since the
+	// last one. Zero disables either test.
+	void	SetRate( int interval, long delta );
+
 public:
 
 	void	Init( int type );
@@ -49,8 +56,23 @@ public:
     int		Update( long update );
     void	Done( int fail );
 
+private:
+    int		CallUpdate( long update );
+
 private:
     int debug;
     SV * progress;
+    P4ProgressStats * stats;
+    int type;
+
+    // Rate limiting
+    int		minInterval;
+    long	minDelta;
+    long	total;
+    long	lastSent;
+    long	pending;
+    int		havePending;
+    int		sentAny;
+    double	lastTime;
 };
 
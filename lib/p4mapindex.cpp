@@ -0,0 +1,174 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4mapindex.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Compiled prefix index over the lines of a MapApi. 
+ *
+ * For each side of the map we collect the literal prefix (everything
+ * before the first wildcard) of every line that can make a path visible,
+ * i.e. everything but exclusions. The prefixes are folded to lower case,
+ * sorted, and reduced to a prefix-free set so that a single binary search
+ * tells us whether any of them is a prefix of a given path. A path that
+ * matches no prefix on either side can't be mapped, so the caller can skip
+ * MapApi entirely; anything else still goes to MapApi for the real answer.
+ *
+ ******************************************************************************/
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <ctype.h>
+#include <clientapi.h>
+#include <mapapi.h>
+#include "perlheaders.h"
+#include "p4mapindex.h"
+
+static inline int
+Fold( char c )
+{
+    return tolower( (unsigned char) c );
+}
+
+P4MapIndex::P4MapIndex( MapApi *map )
+{
+    for( int i = 0; i < map->Count(); i++ )
+    {
+	if( map->GetType( i ) == MapExclude )
+	    continue;
+
+	AddPrefix( lhs, map->GetLeft( i ) );
+	AddPrefix( rhs, map->GetRight( i ) );
+    }
+
+    Minimise( lhs );
+    Minimise( rhs );
+}
+
+int
+P4MapIndex::Candidates( const char *path, int len ) const
+{
+    int	sides = 0;
+
+    if( Matches( lhs, path, len ) ) sides |= SIDE_LEFT;
+    if( Matches( rhs, path, len ) ) sides |= SIDE_RIGHT;
+
+    return sides;
+}
+
+//
+// Extract the literal prefix of one side of a mapping: everything up to
+// the first '*', '...' or '%%n' wildcard.
+//
+void
+P4MapIndex::AddPrefix( PrefixList &l, const StrPtr *s )
+{
+    if( !s ) return;
+
+    const char *	p = s->Text();
+    const char *	e = p + s->Length();
+    std::string		prefix;
+
+    for( ; p < e; p++ )
+    {
+	if( *p == '*' )
+	    break;
+	if( *p == '.' && p + 2 < e && p[1] == '.' && p[2] == '.' )
+	    break;
+	if( *p == '%' && p + 1 < e && p[1] == '%' )
+	    break;
+	prefix += (char) Fold( *p );
+    }
+
+    l.push_back( prefix );
+}
+
+//
+// Sort the prefixes and drop any that are extended by a shorter one;
+// after this no entry in the list is a prefix of another.
+//
+void
+P4MapIndex::Minimise( PrefixList &l )
+{
+    PrefixList	out;
+
+    std::sort( l.begin(), l.end() );
+
+    for( PrefixList::iterator i = l.begin(); i != l.end(); ++i )
+    {
+	if( !out.empty() && 
+	    i->compare( 0, out.back().size(), out.back() ) == 0 )
+	    continue;
+	out.push_back( *i );
+    }
+
+    l.swap( out );
+}
+
+//
+// Since the list is sorted and prefix-free, the only entry that can be a
+// prefix of the path is the greatest one that sorts at or before it.
+//
+int
+P4MapIndex::Matches( const PrefixList &l, const char *p, int len )
+{
+    int	lo = 0;
+    int	hi = l.size();
+
+    while( lo < hi )
+    {
+	int			mid = ( lo + hi ) / 2;
+	const std::string &	s = l[ mid ];
+	int			n = (int) s.size() < len ? s.size() : len;
+	int			cmp = 0;
+
+	for( int i = 0; i < n && !cmp; i++ )
+	    cmp = (unsigned char) s[ i ] - Fold( p[ i ] );
+
+	if( !cmp ) 
+	    cmp = (int) s.size() - len;
+
+	if( cmp <= 0 )
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    if( !lo ) return 0;
+
+    const std::string &	s = l[ lo - 1 ];
+    if( (int) s.size() > len ) return 0;
+
+    for( size_t i = 0; i < s.size(); i++ )
+	if( (unsigned char) s[ i ] != Fold( p[ i ] ) )
+	    return 0;
+
+    return 1;
+}
@@ -0,0 +1,65 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4mapindex.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Compiled prefix index over the lines of a MapApi. Used by
+ * 		  P4MapMaker to reject paths that cannot match any include
+ * 		  line without asking MapApi to walk every mapping.
+ *
+ ******************************************************************************/
+#include <string>
+#include <vector>
+
+class MapApi;
+class P4MapIndex
+{
+    public:
+	enum { SIDE_LEFT = 1, SIDE_RIGHT = 2 };
+
+			P4MapIndex( MapApi *map );
+
+	// Returns a mask of the sides (SIDE_LEFT/SIDE_RIGHT) on which the
+	// path could possibly match. Zero means it can't match at all.
+	int		Candidates( const char *path, int len ) const;
+
+	int		Prefixes() const { return lhs.size() + rhs.size(); }
+
+    private:
+	typedef std::vector<std::string> PrefixList;
+
+	static void	AddPrefix( PrefixList &l, const StrPtr *s );
+	static void	Minimise( PrefixList &l );
+	static int	Matches( const PrefixList &l, const char *p, int len );
+
+	PrefixList	lhs;
+	PrefixList	rhs;
+};
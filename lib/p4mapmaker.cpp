@@ -33,57 +33,323 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * Description	: Class to encapsulate Perforce map manipulation from Perl
  *
  ******************************************************************************/
+#include <map>
+#include <string>
+#include <vector>
+#include <atomic>
 #include <clientapi.h>
 #include <mapapi.h>
 #include "perlheaders.h"
 #include "p4perldebug.h"
+#include "p4mapindex.h"
 #include "p4mapmaker.h"
 
 
+//
+// The MapApi and its compiled index live in a reference counted
+// P4MapData shared between all copies of a map. A P4MapMaker is just a
+// view onto that data, optionally reversed, so copying or reversing a
+// map is free. The data is only duplicated (Detach()) when a view that
+// shares it is about to be modified.
+//
+// Every distinct state of the data has a serial number, assigned when
+// it's created and renewed whenever it's changed in place. JoinAll()
+// uses it to recognise inputs it has seen before. The counter is atomic
+// so serials stay unique when several interpreters run maps at once.
+//
+class P4MapData
+{
+    public:
+		P4MapData() { map = new MapApi; index = 0; refs = 1; Touch(); }
+		~P4MapData() { delete index; delete map; }
+
+	void	Touch() { serial = ++lastSerial; }
+
+	MapApi *	map;
+	P4MapIndex *	index;
+	int		refs;
+	unsigned long	serial;
+
+    private:
+	static std::atomic<unsigned long>	lastSerial;
+};
+
+std::atomic<unsigned long> P4MapData::lastSerial( 0 );
+
 P4MapMaker::P4MapMaker()
 {
-    map = new MapApi;
+    data = new P4MapData;
+    reversed = 0;
+}
+
+P4MapMaker::P4MapMaker( P4MapData *d )
+{
+    data = d;
+    data->refs++;
+    reversed = 0;
 }
 
 P4MapMaker::~P4MapMaker()
 {
-    delete map;
+    if( !--data->refs )
+	delete data;
 }
 
 P4MapMaker::P4MapMaker( const P4MapMaker &m )
 {
-    StrBuf	l, r;
-    const StrPtr *s;
-    MapType	t;
-    int 	i;
+    data = m.data;
+    data->refs++;
+    reversed = m.reversed;
+}
 
-    map = new MapApi;
-    for( i = 0; i < m.map->Count(); i++ )
-    {
-	s = m.map->GetLeft( i );
-	if( !s ) break;
-	l = *s;
+//
+// Give this view its own private copy of the map data, so that it can
+// be modified without affecting any other view sharing it.
+//
+void
+P4MapMaker::Detach()
+{
+    if( data->refs == 1 )
+	return;
 
-	s = m.map->GetRight( i );
-	if( !s ) break;
-	r = *s;
+    P4MapData *		nd = new P4MapData;
+    MapApi *		map = data->map;
+    const StrPtr *	l;
+    const StrPtr *	r;
 
-	t = m.map->GetType( i );
+    // Copy the entries as they're stored, not as seen through this view:
+    // the copy stays under the same 'reversed' flag.
+    for( int i = 0; i < data->map->Count(); i++ )
+    {
+	l = map->GetLeft( i );
+	r = map->GetRight( i );
+	if( !l || !r ) break;
 
-	map->Insert( l, r, t );
+	nd->map->Insert( *l, *r, map->GetType( i ) );
     }
+
+    data->refs--;
+    data = nd;
+}
+
+int
+P4MapMaker::IsShared()
+{
+    return data->refs > 1;
+}
+
+const StrPtr *
+P4MapMaker::Left( int i )
+{
+    return reversed ? data->map->GetRight( i ) : data->map->GetLeft( i );
+}
+
+const StrPtr *
+P4MapMaker::Right( int i )
+{
+    return reversed ? data->map->GetLeft( i ) : data->map->GetRight( i );
 }
 
 P4MapMaker *
 P4MapMaker::Join( P4MapMaker *l, P4MapMaker *r)
 {
     P4MapMaker *m = new P4MapMaker();
-    delete m->map;
+    delete m->data->map;
+
+    m->data->map = MapApi::Join( 
+		l->data->map, l->reversed ? MapRightLeft : MapLeftRight,
+		r->data->map, r->reversed ? MapRightLeft : MapLeftRight );
+    return m;
+}
+
+//
+// Join a chain of maps: the lhs of the first through to the rhs of the
+// last. Joining is associative, so rather than working strictly left to
+// right we repeatedly join the adjacent pair whose product of entry
+// counts is smallest, which keeps the intermediate maps small.
+//
+// Every intermediate result is cached under the identity (serial and
+// direction) of the run of input maps it was made from, so repeating a
+// chain - or any chain sharing a run of inputs with an earlier one -
+// reuses the earlier work. Cached results are shared with the caller
+// copy-on-write, so the caller can't disturb the cache.
+//
+// The cache is per thread, and so per interpreter under ithreads: the
+// reference counts in P4MapData aren't atomic, so the data must never be
+// shared between interpreters, and a thread only ever finds results made
+// from its own maps anyway. ClearJoinCache() clears the calling thread's
+// cache only.
+//
+struct P4JoinCacheEntry
+{
+    P4MapData *		data;
+    unsigned long	used;
+};
+
+static void
+ReleaseData( P4MapData *d )
+{
+    if( !--d->refs )
+	delete d;
+}
+
+struct P4JoinCache
+{
+    std::map<std::string, P4JoinCacheEntry>	entries;
+    unsigned long				clock;
+
+    P4JoinCache() { clock = 0; }
+
+    ~P4JoinCache() { Clear(); }
+
+    void Clear()
+    {
+	std::map<std::string, P4JoinCacheEntry>::iterator i;
+	for( i = entries.begin(); i != entries.end(); ++i )
+	    ReleaseData( i->second.data );
+	entries.clear();
+    }
+};
+
+static thread_local P4JoinCache	joinCache;
+static const size_t		joinCacheMax = 64;
+
+static P4MapData *
+JoinCacheFind( const std::string &key )
+{
+    std::map<std::string, P4JoinCacheEntry>::iterator i;
 
-    m->map = MapApi::Join( l->map, r->map );
+    i = joinCache.entries.find( key );
+    if( i == joinCache.entries.end() )
+	return 0;
+
+    i->second.used = ++joinCache.clock;
+    return i->second.data;
+}
+
+static void
+JoinCacheAdd( const std::string &key, P4MapData *d )
+{
+    std::map<std::string, P4JoinCacheEntry> &entries = joinCache.entries;
+
+    if( entries.size() >= joinCacheMax )
+    {
+	std::map<std::string, P4JoinCacheEntry>::iterator oldest, i;
+	oldest = entries.begin();
+	for( i = entries.begin(); i != entries.end(); ++i )
+	    if( i->second.used < oldest->second.used )
+		oldest = i;
+
+	ReleaseData( oldest->second.data );
+	entries.erase( oldest );
+    }
+
+    P4JoinCacheEntry &e = entries[ key ];
+    e.data = d;
+    e.used = ++joinCache.clock;
+    d->refs++;
+}
+
+void
+P4MapMaker::ClearJoinCache()
+{
+    joinCache.Clear();
+}
+
+P4MapMaker *
+P4MapMaker::JoinAll( P4MapMaker **maps, int count )
+{
+    struct Segment
+    {
+	P4MapData *	data;
+	int		reversed;
+	std::string	key;
+    };
+
+    std::vector<Segment>	segs;
+    P4MapData *			d;
+    char			id[ 64 ];
+
+    if( !count )
+	return new P4MapMaker();
+
+    if( count == 1 )
+	return new P4MapMaker( *maps[ 0 ] );
+
+    for( int i = 0; i < count; i++ )
+    {
+	Segment s;
+	s.data = maps[ i ]->data;
+	s.reversed = maps[ i ]->reversed;
+	sprintf( id, "%lu%c/", s.data->serial, s.reversed ? 'r' : 'f' );
+	s.key = id;
+	s.data->refs++;
+	segs.push_back( s );
+    }
+
+    while( segs.size() > 1 )
+    {
+	// Pick the cheapest adjacent pair.
+	size_t	best = 0;
+	double	bestCost = -1;
+
+	for( size_t i = 0; i + 1 < segs.size(); i++ )
+	{
+	    double cost = (double) segs[ i ].data->map->Count() *
+			  (double) segs[ i + 1 ].data->map->Count();
+	    if( bestCost < 0 || cost < bestCost )
+	    {
+		best = i;
+		bestCost = cost;
+	    }
+	}
+
+	Segment &	l = segs[ best ];
+	Segment &	r = segs[ best + 1 ];
+	std::string	key = l.key + r.key;
+
+	if( !( d = JoinCacheFind( key ) ) )
+	{
+	    d = new P4MapData;
+	    delete d->map;
+	    d->map = MapApi::Join(
+		    l.data->map, l.reversed ? MapRightLeft : MapLeftRight,
+		    r.data->map, r.reversed ? MapRightLeft : MapLeftRight );
+	    JoinCacheAdd( key, d );
+	    d->refs--;
+	}
+
+	d->refs++;
+	ReleaseData( l.data );
+	ReleaseData( r.data );
+
+	l.data = d;
+	l.reversed = 0;
+	l.key = key;
+	segs.erase( segs.begin() + best + 1 );
+    }
+
+    P4MapMaker *m = new P4MapMaker( segs[ 0 ].data );
+    ReleaseData( segs[ 0 ].data );
     return m;
 }
 
+//
+// Insert a mapping as seen through this view. Detaches from any shared
+// data first, and swaps the halves if the view is reversed.
+//
+void
+P4MapMaker::Insert( const StrPtr &l, const StrPtr &r, int t )
+{
+    Detach();
+    Invalidate();
+
+    if( reversed )
+	data->map->Insert( r, l, (MapType) t );
+    else
+	data->map->Insert( l, r, (MapType) t );
+}
+
 void
 P4MapMaker::Insert( SV * m )
 {
@@ -110,7 +376,7 @@ P4MapMaker::Insert( SV * m )
 	t = MapOverlay;
     }
 
-    map->Insert( l, r, t );
+    Insert( l, r, t );
 }
 
 
@@ -178,40 +444,33 @@ P4MapMaker::Insert( SV * l, SV * r )
     left.Terminate();
     right.Terminate();
 
-    map->Insert( left, right, t );
+    Insert( left, right, t );
 }
 
 int
 P4MapMaker::Count()
 {
-    return map->Count();
+    return data->map->Count();
 }
 
 void
 P4MapMaker::Clear()
 {
-    map->Clear();
+    if( !--data->refs )
+	delete data;
+
+    data = new P4MapData;
+    reversed = 0;
 }
 
+//
+// Reversing a view just flips the direction in which it reads the shared
+// map; nothing is copied.
+//
 void
 P4MapMaker::Reverse()
 {
-    MapApi *		nmap = new MapApi;
-    const StrPtr *	l;
-    const StrPtr *	r;
-    MapType		t;
-
-    for( int i = 0; i < map->Count(); i++ )
-    {
-	l = map->GetLeft( i );
-	r = map->GetRight( i );
-	t = map->GetType( i );
-
-	nmap->Insert( *r, *l, t );
-    }
-
-    delete map;
-    map = nmap;
+    reversed = !reversed;
 }
 
 SV *
@@ -221,15 +480,145 @@ P4MapMaker::Translate( SV * p, int fwd )
     StrBuf	to;
     MapDir	dir = MapLeftRight;
 
-    if( !fwd )
+    if( !fwd == !reversed )
 	dir = MapRightLeft;
 
     from = SvPV( p, PL_na );
-    if( map->Translate( from, to, dir ) )
+    if( data->map->Translate( from, to, dir ) )
 	return newSVpv( to.Text(), to.Length() );
     return 0;
 }
 
+//
+// Translate every entry in the supplied array in one pass, returning a
+// new array of the same length. Entries that don't map (or that aren't
+// defined in the input) are returned as undef. The input and output
+// buffers are reused across the whole array so a large batch costs one
+// SV per result and nothing more.
+//
+AV *
+P4MapMaker::TranslateArray( AV * paths, int fwd )
+{
+    AV *	a = newAV();
+    StrBuf	from;
+    StrBuf	to;
+    SV **	svp;
+    char *	p;
+    STRLEN	len;
+    I32		last = av_len( paths );
+    MapDir	dir = MapLeftRight;
+
+    if( !fwd == !reversed )
+	dir = MapRightLeft;
+
+    if( last >= 0 )
+	av_extend( a, last );
+
+    for( I32 i = 0; i <= last; i++ )
+    {
+	svp = av_fetch( paths, i, 0 );
+	if( !svp || !SvOK( *svp ) )
+	{
+	    av_store( a, i, newSV( 0 ) );
+	    continue;
+	}
+
+	p = SvPV( *svp, len );
+	from.Set( p, len );
+	to.Clear();
+
+	if( data->map->Translate( from, to, dir ) )
+	    av_store( a, i, newSVpv( to.Text(), to.Length() ) );
+	else
+	    av_store( a, i, newSV( 0 ) );
+    }
+    return a;
+}
+
+//
+// Returns non-zero if the path is visible through either side of the
+// mapping. If the map has been compiled, paths that can't match any
+// line are rejected without consulting MapApi.
+//
+int
+P4MapMaker::Includes( const char *path, int len )
+{
+    StrRef	p( path, len );
+    int		sides = P4MapIndex::SIDE_LEFT | P4MapIndex::SIDE_RIGHT;
+
+    if( data->index )
+	sides = data->index->Candidates( path, len );
+
+    if( ( sides & P4MapIndex::SIDE_LEFT ) && 
+	data->map->Translate( p, scratch, MapLeftRight ) )
+	return 1;
+
+    if( ( sides & P4MapIndex::SIDE_RIGHT ) && 
+	data->map->Translate( p, scratch, MapRightLeft ) )
+	return 1;
+
+    return 0;
+}
+
+//
+// Bulk form of Includes(). Compiles the map first if that hasn't
+// already been done, since that's where the savings are.
+//
+AV *
+P4MapMaker::IncludesArray( AV * paths )
+{
+    AV *	a = newAV();
+    SV **	svp;
+    char *	p;
+    STRLEN	len;
+    I32		last = av_len( paths );
+
+    if( !data->index )
+	Compile();
+
+    if( last >= 0 )
+	av_extend( a, last );
+
+    for( I32 i = 0; i <= last; i++ )
+    {
+	svp = av_fetch( paths, i, 0 );
+	if( !svp || !SvOK( *svp ) )
+	{
+	    av_store( a, i, newSViv( 0 ) );
+	    continue;
+	}
+
+	p = SvPV( *svp, len );
+	av_store( a, i, newSViv( Includes( p, len ) ) );
+    }
+    return a;
+}
+
+//
+// The index is a property of the map data rather than the view, so
+// compiling one view compiles every view that shares it.
+//
+void
+P4MapMaker::Compile()
+{
+    delete data->index;
+    data->index = new P4MapIndex( data->map );
+}
+
+int
+P4MapMaker::IsCompiled()
+{
+    return data->index != 0;
+}
+
+void
+P4MapMaker::Invalidate()
+{
+    delete data->index;
+    data->index = 0;
+    data->Touch();
+}
+
 AV *
 P4MapMaker::Lhs()
 {
@@ -239,13 +628,13 @@ P4MapMaker::Lhs()
     MapType		t;
     int			quote;
 
-    for( int i = 0; i < map->Count(); i++ )
+    for( int i = 0; i < data->map->Count(); i++ )
     {
 	s.Clear();
 	quote = 0;
 
-	l = map->GetLeft( i );
-	t = map->GetType( i );
+	l = Left( i );
+	t = data->map->GetType( i );
 
 	if( l->Contains( StrRef( " " ) ) )
 	{
@@ -284,12 +673,12 @@ P4MapMaker::Rhs()
     const StrPtr *	r;
     int			quote;
 
-    for( int i = 0; i < map->Count(); i++ )
+    for( int i = 0; i < data->map->Count(); i++ )
     {
 	s.Clear();
 	quote = 0;
 
-	r = map->GetRight( i );
+	r = Right( i );
 
 	if( r->Contains( StrRef( " " ) ) )
 	{
@@ -315,14 +704,14 @@ P4MapMaker::ToA()
     MapType		t;
     int			quote;
 
-    for( int i = 0; i < map->Count(); i++ )
+    for( int i = 0; i < data->map->Count(); i++ )
     {
 	s.Clear();
 	quote = 0;
 
-	l = map->GetLeft( i );
-	r = map->GetRight( i );
-	t = map->GetType( i );
+	l = Left( i );
+	r = Right( i );
+	t = data->map->GetType( i );
 
 	if( l->Contains( StrRef( " " ) ) ||
 	    r->Contains( StrRef( " " ) ) )
@@ -364,7 +753,7 @@ P4MapMaker::Dump()
 {
     StrBuf b;
 
-    if( !map->Count() )
+    if( !data->map->Count() )
     {
 	b << "(empty)";
 	return newSVpv( b.Text(), b.Length() );
@@ -375,12 +764,12 @@ P4MapMaker::Dump()
 
     b << "\n";
 
-    for( int i = 0; i < map->Count(); i++ )
+    for( int i = 0; i < data->map->Count(); i++ )
     {
 
-	l = map->GetLeft( i );
-	r = map->GetRight( i );
-	t = map->GetType( i );
+	l = Left( i );
+	r = Right( i );
+	t = data->map->GetType( i );
 
 	b << "\t";
 	switch( t )
@@ -410,6 +799,130 @@ P4MapMaker::Dump()
     return newSVpv( b.Text(), b.Length() );
 }
 
+//
+// Binary serialisation. The format is:
+//
+//	"P4MAP" <version:1> <flags:1> <count:4>
+//	then, per entry:  <type:1> <llen:4> <lhs> <rlen:4> <rhs>
+//
+// with all integers little-endian. Entries are stored exactly as MapApi
+// holds them (i.e. after disambiguation), so Thaw() can insert them
+// straight back without going through SplitMapping() and friends.
+//
+static const char	freezeMagic[] = "P4MAP";
+static const int	freezeMagicLen = 5;
+static const int	freezeVersion = 1;
+static const int	freezeCompiled = 0x01;
+
+static void
+PutU32( StrBuf &b, unsigned int v )
+{
+    char	c[ 4 ];
+
+    c[ 0 ] = v & 0xff;
+    c[ 1 ] = ( v >> 8 ) & 0xff;
+    c[ 2 ] = ( v >> 16 ) & 0xff;
+    c[ 3 ] = ( v >> 24 ) & 0xff;
+    b.Append( c, 4 );
+}
+
+static int
+GetU32( const char *&p, const char *e, unsigned int &v )
+{
+    const unsigned char *u = (const unsigned char *) p;
+
+    if( e - p < 4 ) return 0;
+    v = u[ 0 ] | ( u[ 1 ] << 8 ) | ( u[ 2 ] << 16 ) | ( (unsigned) u[ 3 ] << 24 );
+    p += 4;
+    return 1;
+}
+
+SV *
+P4MapMaker::Freeze()
+{
+    StrBuf		b;
+    const StrPtr *	l;
+    const StrPtr *	r;
+    char		c;
+
+    b.Append( freezeMagic, freezeMagicLen );
+    c = freezeVersion;
+    b.Append( &c, 1 );
+    c = data->index ? freezeCompiled : 0;
+    b.Append( &c, 1 );
+    PutU32( b, data->map->Count() );
+
+    for( int i = 0; i < data->map->Count(); i++ )
+    {
+	l = Left( i );
+	r = Right( i );
+	c = (char) data->map->GetType( i );
+
+	b.Append( &c, 1 );
+	PutU32( b, l->Length() );
+	b.Append( l->Text(), l->Length() );
+	PutU32( b, r->Length() );
+	b.Append( r->Text(), r->Length() );
+    }
+
+    return newSVpvn( b.Text(), b.Length() );
+}
+
+P4MapMaker *
+P4MapMaker::Thaw( const char *data, STRLEN len )
+{
+    const char *	p = data;
+    const char *	e = data + len;
+    unsigned int	count;
+    unsigned int	llen;
+    unsigned int	rlen;
+    unsigned int	i;
+    int			flags;
+    int			t;
+    StrBuf		l;
+    StrBuf		r;
+
+    if( len < (STRLEN) freezeMagicLen + 6 ||
+	memcmp( p, freezeMagic, freezeMagicLen ) ||
+	p[ freezeMagicLen ] != freezeVersion )
+	return 0;
+
+    p += freezeMagicLen + 1;
+    flags = *p++;
+    GetU32( p, e, count );
+
+    P4MapMaker *m = new P4MapMaker();
+
+    for( i = 0; i < count; i++ )
+    {
+	if( p >= e ) break;
+	t = *p++;
+
+	if( !GetU32( p, e, llen ) || (unsigned int)( e - p ) < llen ) break;
+	l.Set( p, llen );
+	p += llen;
+
+	if( !GetU32( p, e, rlen ) || (unsigned int)( e - p ) < rlen ) break;
+	r.Set( p, rlen );
+	p += rlen;
+
+	if( t < MapInclude || t > MapOneToMany ) break;
+
+	m->data->map->Insert( l, r, (MapType) t );
+    }
+
+    if( i != count || p != e )
+    {
+	delete m;
+	return 0;
+    }
+
+    if( flags & freezeCompiled )
+	m->Compile();
+
+    return m;
+}
+
 //
 // Take a single string containing either a half-map, or both halves of
 // a mapping and split it in two. If there's only one half of a mapping in
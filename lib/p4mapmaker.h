@@ -35,6 +35,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  ******************************************************************************/
 
 class MapApi;
+class P4MapIndex;
+class P4MapData;
 class P4MapMaker
 {
     public:
@@ -45,6 +47,13 @@ class P4MapMaker
 
 	static P4MapMaker * Join( P4MapMaker *l, P4MapMaker *r);
 
+	// JoinAll() caches its intermediate joins per thread, which under
+	// ithreads means per interpreter; ClearJoinCache() empties the
+	// calling thread's cache.
+	static P4MapMaker * JoinAll( P4MapMaker **maps, int count );
+	static void	ClearJoinCache();
+	static P4MapMaker * Thaw( const char *data, STRLEN len );
+
 	void		Insert( SV * m );
 	void		Insert( SV * l, SV * r );
 
@@ -52,15 +61,36 @@ class P4MapMaker
 	void		Clear();
 	int		Count();
 	SV *		Translate( SV * p, int fwd = 1 );
+	AV *		TranslateArray( AV * paths, int fwd = 1 );
+	int		Includes( const char *path, int len );
+	AV *		IncludesArray( AV * paths );
+
+	void		Compile();
+	int		IsCompiled();
+	int		IsReversed()	{ return reversed; }
+	int		IsShared();
+
 	AV *		Lhs();
 	AV *		Rhs();
 	AV *		ToA();
 
 	SV *		Dump();
+	SV *		Freeze();
 
     private:
+	P4MapMaker( P4MapData *d );
+
 	void		SplitMapping( const StrPtr &in, StrBuf &l, StrBuf &r );
-	MapApi *	map;
+	void		Invalidate();
+	void		Detach();
+	void		Insert( const StrPtr &l, const StrPtr &r, int t );
+
+	const StrPtr *	Left( int i );
+	const StrPtr *	Right( int i );
+
+	P4MapData *	data;
+	int		reversed;
+	StrBuf		scratch;
 };
 
 
@@ -47,6 +47,8 @@ P4MergeData::P4MergeData(ClientUser *ui, ClientMerge *m, StrPtr &hint) {
 	this->ui = ui;
 	this->merger = m;
 	this->hint = hint;
+	this->linesCounted = 0;
+	this->yourLines = this->theirLines = this->baseLines = 0;
 
 	// Extract (forcibly) the paths from the RPC buffer.
 	StrPtr *t;
@@ -109,6 +111,91 @@ SV *P4MergeData::GetMergeHint() {
 	return newSVpv(hint.Text(), hint.Length());
 }
 
+SV *P4MergeData::GetYourChunks() {
+	return newSViv(merger->GetYourChunks());
+}
+
+SV *P4MergeData::GetTheirChunks() {
+	return newSViv(merger->GetTheirChunks());
+}
+
+SV *P4MergeData::GetBothChunks() {
+	return newSViv(merger->GetBothChunks());
+}
+
+SV *P4MergeData::GetConflictChunks() {
+	return newSViv(merger->GetConflictChunks());
+}
+
+/*
+ * Chunk counts come straight from the merger; line counts are taken
+ * from the three input files the first time they're asked for, so
+ * resolvers don't have to open and diff the files in Perl.
+ */
+HV *P4MergeData::GetStats() {
+	HV *h = newHV();
+
+	if (!linesCounted) {
+		yourLines = CountLines(merger->GetYourFile());
+		theirLines = CountLines(merger->GetTheirFile());
+		baseLines = CountLines(merger->GetBaseFile());
+		linesCounted = 1;
+	}
+
+	hv_store( h, "YourChunks", 10, newSViv( merger->GetYourChunks() ), 0 );
+	hv_store( h, "TheirChunks", 11, newSViv( merger->GetTheirChunks() ), 0 );
+	hv_store( h, "BothChunks", 10, newSViv( merger->GetBothChunks() ), 0 );
+	hv_store( h, "ConflictChunks", 14,
+			newSViv( merger->GetConflictChunks() ), 0 );
+	hv_store( h, "YourLines", 9, newSViv( yourLines ), 0 );
+	hv_store( h, "TheirLines", 10, newSViv( theirLines ), 0 );
+	hv_store( h, "BaseLines", 9, newSViv( baseLines ), 0 );
+
+	return h;
+}
+
+/*
+ * Count the lines in one of the merge files. We read through a FileSys
+ * of our own so that the merger's handles are left alone, and so that
+ * utf16 and line-ending translation happen as they would for the merge.
+ */
+int P4MergeData::CountLines(FileSys *src) {
+	if (!src)
+		return 0;
+
+	Error e;
+	FileSys *f = FileSys::Create(src->GetType());
+	f->Set(*src->Path());
+	f->Open(FOM_READ, &e);
+	if (e.Test()) {
+		delete f;
+		return 0;
+	}
+
+	char buf[ 65536 ];
+	int lines = 0;
+	int n;
+	char last = '\n';
+
+	while ((n = f->Read(buf, sizeof(buf), &e)) > 0 && !e.Test()) {
+		for (char *p = buf; (p = (char *) memchr(p, '\n', buf + n - p)); p++)
+			lines++;
+		last = buf[n - 1];
+	}
+
+	// An unterminated last line still counts
+	if (last != '\n')
+		lines++;
+
+	f->Close(&e);
+	delete f;
+
+	if (P4PERL_DEBUG_FLOW)
+		PerlIO_stdoutf("[P4MergeData::CountLines] %s: %d lines\n",
+				src->Name(), lines);
+	return lines;
+}
+
 SV *P4MergeData::RunMergeTool() {
 	Error e;
 	ui->Merge(merger->GetBaseFile(), merger->GetTheirFile(),
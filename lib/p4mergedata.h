@@ -54,11 +54,24 @@ public:
 
 	SV * GetMergeHint();
 
+	SV * GetYourChunks();
+	SV * GetTheirChunks();
+	SV * GetBothChunks();
+	SV * GetConflictChunks();
+	HV * GetStats();
+
 	SV * RunMergeTool();
 
 	StrBuf GetString();
 
 private:
+	int CountLines(FileSys *f);
+
+	int linesCounted;
+	int yourLines;
+	int theirLines;
+	int baseLines;
+
 	int debug;
 	ClientUser * ui;
 	StrBuf hint;
@@ -0,0 +1,360 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4nativehandler.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Output handlers implemented in C++: P4::Handler::Count,
+ * 		  ::Collect, ::Grep and ::ToFile.
+ *
+ * PerlClientUser hands tagged output to these before it's converted to a
+ * hash, so records a handler deals with never become Perl data at all,
+ * and none of them calls back into Perl. Answers follow the rules for a
+ * P4::OutputHandler: HANDLED keeps the record out of the results, and
+ * Grep returns REPORT for a match so that it's converted and kept as
+ * usual.
+ *
+ * A field matches both the plain key and its indexed forms, so a field
+ * of 'depotFile' picks up 'depotFile0', 'depotFile1' and so on from
+ * commands like 'describe', as well as 'depotFile' from 'files'.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include <ctype.h>
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4utf8.h"
+#include "p4ndjson.h"
+#include "p4nativehandler.h"
+
+P4NativeHandler::P4NativeHandler( Kind k )
+{
+	kind = k;
+	count = 0;
+	failed = 0;
+	values = newAV();
+	rx = 0;
+	subject = 0;
+	fh = 0;
+	format = NF_ZTAG;
+}
+
+P4NativeHandler::~P4NativeHandler()
+{
+	SvREFCNT_dec( (SV *) values );
+	if( rx ) SvREFCNT_dec( (SV *) rx );
+	if( subject ) SvREFCNT_dec( subject );
+	if( fh ) SvREFCNT_dec( fh );
+}
+
+int
+P4NativeHandler::SetField( SV *f )
+{
+	STRLEN len;
+
+	if( !f || !SvOK( f ) || !*SvPV( f, len ) )
+	{
+	    warn( "P4::Handler: a field name is required" );
+	    return 0;
+	}
+
+	const char *s = SvPV( f, len );
+	field.Set( s, len );
+	return 1;
+}
+
+int
+P4NativeHandler::SetPattern( SV *f, SV *pattern )
+{
+	if( !SetField( f ) )
+	    return 0;
+
+	if( !pattern || !SvOK( pattern ) )
+	{
+	    warn( "P4::Handler::Grep: a pattern is required" );
+	    return 0;
+	}
+
+	// A qr// is used as it is; anything else is compiled as a pattern
+	if( ( rx = SvRX( pattern ) ) )
+	    SvREFCNT_inc_simple_void_NN( (SV *) rx );
+	else
+	    rx = pregcomp( pattern, 0 );
+
+	subject = newSV( 0 );
+	return 1;
+}
+
+int
+P4NativeHandler::SetFile( SV *h, SV *fmt )
+{
+	SV *t = h && SvROK( h ) ? SvRV( h ) : h;
+
+	// Hold on to the glob (or IO) itself, so that it outlives the
+	// caller's variable. The PerlIO is looked up for each write, as
+	// the handle may since have been closed or reopened.
+	if( t && ( SvTYPE( t ) == SVt_PVGV || SvTYPE( t ) == SVt_PVIO ) )
+	    fh = t;
+
+	if( !File() )
+	{
+	    fh = 0;
+	    warn( "P4::Handler::ToFile: filehandle is not open for writing" );
+	    return 0;
+	}
+
+	if( fmt && SvOK( fmt ) && !strcmp( SvPV_nolen( fmt ), "json" ) )
+	    format = NF_JSON;
+	else if( fmt && SvOK( fmt ) && strcmp( SvPV_nolen( fmt ), "ztag" ) )
+	{
+	    if( !strchr( SvPV_nolen( fmt ), '%' ) )
+	    {
+		warn( "P4::Handler::ToFile: unknown format '%s'",
+			SvPV_nolen( fmt ) );
+		return 0;
+	    }
+	    format = NF_TEMPLATE;
+	    templ.Set( SvPV_nolen( fmt ) );
+	}
+
+	SvREFCNT_inc_simple_void_NN( fh );
+	return 1;
+}
+
+void
+P4NativeHandler::Reset()
+{
+	count = 0;
+	failed = 0;
+	av_clear( values );
+}
+
+int
+P4NativeHandler::OutputStat( StrDict *dict, int utf8 )
+{
+	StrRef var, val;
+	int found = 0;
+	int i;
+
+	switch( kind )
+	{
+	case NH_COUNT:
+	    count++;
+	    return HANDLED;
+
+	case NH_COLLECT:
+	    for( i = 0; dict->GetVar( i, var, val ); i++ )
+	    {
+		if( !FieldMatches( var ) )
+		    continue;
+
+		SV *sv = newSVpv( val.Text(), val.Length() );
+		P4Utf8::Mark( sv, utf8 );
+		av_push( values, sv );
+		found = 1;
+	    }
+	    count += found;
+	    return HANDLED;
+
+	case NH_GREP:
+	    for( i = 0; dict->GetVar( i, var, val ); i++ )
+	    {
+		if( FieldMatches( var ) 
+			&& Matches( val.Text(), val.Length(), utf8 ) )
+		{
+		    count++;
+		    return REPORT;
+		}
+	    }
+	    return HANDLED;
+
+	case NH_TOFILE:
+	    // One buffer serves for every record
+	    line.Clear();
+	    if( format == NF_JSON )
+		P4Ndjson::Format( dict, utf8, line );
+	    else if( format == NF_TEMPLATE )
+		FormatTemplate( dict, line );
+	    else
+		FormatZtag( dict, line );
+
+	    if( !Write( line.Text(), line.Length() ) )
+		return HANDLED | CANCEL;
+	    count++;
+	    return HANDLED;
+	}
+	return REPORT;
+}
+
+int
+P4NativeHandler::Output( const char *method, SV *data )
+{
+	// Nothing but strings comes this way, but be sure
+	if( SvROK( data ) )
+	    return REPORT;
+
+	STRLEN len;
+	const char *s = SvPV( data, len );
+
+	switch( kind )
+	{
+	case NH_COUNT:
+	    count++;
+	    return HANDLED;
+
+	case NH_COLLECT:
+	    // No fields to collect from
+	    return REPORT;
+
+	case NH_GREP:
+	    if( !Matches( s, len, SvUTF8( data ) ? P4Utf8::TRUST 
+						 : P4Utf8::BYTES ) )
+		return HANDLED;
+	    count++;
+	    return REPORT;
+
+	case NH_TOFILE:
+	    // Untagged output would spoil a stream of JSON, so it's kept
+	    if( format == NF_JSON )
+		return REPORT;
+
+	    // Info lines come without their newline; text is as it was sent
+	    if( !Write( s, len ) || 
+		( !strcmp( method, "OutputInfo" ) && !Write( "\n", 1 ) ) )
+		return HANDLED | CANCEL;
+	    count++;
+	    return HANDLED;
+	}
+	return REPORT;
+}
+
+int
+P4NativeHandler::FieldMatches( const StrPtr &var )
+{
+	int n = field.Length();
+
+	if( var.Length() < n || strncmp( var.Text(), field.Text(), n ) )
+	    return 0;
+
+	// The rest, if any, must be an index: digits and commas
+	for( const char *p = var.Text() + n; *p; p++ )
+	    if( !isdigit( (unsigned char) *p ) && *p != ',' )
+		return 0;
+
+	return 1;
+}
+
+int
+P4NativeHandler::Matches( const char *s, STRLEN len, int utf8 )
+{
+	// The subject SV is reused, so that matching creates nothing
+	sv_setpvn( subject, s, len );
+	SvUTF8_off( subject );
+	P4Utf8::Mark( subject, utf8 );
+
+	char *p = SvPVX( subject );
+	return pregexec( rx, p, p + len, p, 0, subject, 1 ) > 0;
+}
+
+void
+P4NativeHandler::FormatZtag( StrDict *dict, StrBuf &b )
+{
+	StrRef var, val;
+
+	for( int i = 0; dict->GetVar( i, var, val ); i++ )
+	{
+	    if( var == "specdef" || var == "func" || var == "specFormatted" )
+		continue;
+
+	    b << "... " << var << " " << val << "\n";
+	}
+	b << "\n";
+}
+
+//
+// %field% is replaced with the field's value, or nothing if the record
+// doesn't have it, and %% with a single %.
+//
+void
+P4NativeHandler::FormatTemplate( StrDict *dict, StrBuf &b )
+{
+	const char *p = templ.Text();
+	const char *s;
+	const char *e;
+
+	while( ( s = strchr( p, '%' ) ) && ( e = strchr( s + 1, '%' ) ) )
+	{
+	    b.Append( p, s - p );
+
+	    if( e == s + 1 )
+		b << "%";
+	    else
+	    {
+		StrBuf name;
+		name.Set( s + 1, e - s - 1 );
+
+		StrPtr *v = dict->GetVar( name );
+		if( v )
+		    b << *v;
+	    }
+	    p = e + 1;
+	}
+	b << p << "\n";
+}
+
+PerlIO *
+P4NativeHandler::File()
+{
+	if( !fh )
+	    return 0;
+
+	IO *io = SvTYPE( fh ) == SVt_PVGV ? GvIO( (GV *) fh ) : (IO *) fh;
+	return io ? IoOFP( io ) : 0;
+}
+
+int
+P4NativeHandler::Write( const char *s, STRLEN len )
+{
+	if( failed )
+	    return 0;
+
+	PerlIO *out = File();
+	if( !out )
+	{
+	    warn( "P4::Handler::ToFile: filehandle is no longer open" );
+	    failed = 1;
+	}
+	else if( PerlIO_write( out, s, len ) != (SSize_t) len )
+	{
+	    warn( "P4::Handler::ToFile: error writing to filehandle" );
+	    failed = 1;
+	}
+	return !failed;
+}
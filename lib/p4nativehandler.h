@@ -0,0 +1,97 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4nativehandler.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Output handlers implemented in C++: P4::Handler::Count,
+ * 		  ::Collect, ::Grep and ::ToFile.
+ *
+ ******************************************************************************/
+
+class P4NativeHandler
+{
+    public:
+	enum Kind {
+	    NH_COUNT,		// count the records
+	    NH_COLLECT,		// gather one field's values
+	    NH_GREP,		// keep only records that match a pattern
+	    NH_TOFILE		// write the records to a filehandle
+	};
+
+	enum Format {
+	    NF_ZTAG,		// '... field value' lines, as 'p4 -ztag'
+	    NF_TEMPLATE,	// a line per record with %field% expanded
+	    NF_JSON		// a JSON object per line
+	};
+
+	// Answers use the same bits as a P4::OutputHandler's return value
+	enum { REPORT = 0, HANDLED = 1, CANCEL = 2 };
+
+			P4NativeHandler( Kind k );
+			~P4NativeHandler();
+
+	// Each returns 0, with a warning, if the argument won't do
+	int		SetField( SV *f );
+	int		SetPattern( SV *f, SV *pattern );
+	int		SetFile( SV *fh, SV *format );
+
+	// Tagged output is handed over before it becomes a hash, and
+	// anything else as the string it would have been added as.
+	int		OutputStat( StrDict *dict, int utf8 );
+	int		Output( const char *method, SV *data );
+
+	int		GetCount() { return count; }
+	AV *		GetValues() { return values; }
+	void		Reset();
+
+    private:
+	int		FieldMatches( const StrPtr &var );
+	int		Matches( const char *s, STRLEN len, int utf8 );
+	void		FormatZtag( StrDict *dict, StrBuf &b );
+	void		FormatTemplate( StrDict *dict, StrBuf &b );
+	int		Write( const char *s, STRLEN len );
+	PerlIO *	File();
+
+	Kind		kind;
+	int		count;
+	int		failed;
+
+	StrBuf		field;
+	AV *		values;
+
+	REGEXP *	rx;
+	SV *		subject;
+
+	SV *		fh;		// the glob or IO, not the caller's ref
+	Format		format;
+	StrBuf		templ;
+	StrBuf		line;
+};
@@ -0,0 +1,327 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4ndjson.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Formatting of tagged output as JSON, one object per line,
+ * 		  straight from the StrDict.
+ *
+ * The structure is that of the hash SpecMgr::StrDictToHash() would build
+ * from the same record, so that a line decodes to what encoding that hash
+ * would have produced: 'depotFile0', 'depotFile1' become an array under
+ * 'depotFile', 'how0,1' an array within an array, missing entries are
+ * null, and the same collisions are resolved the same way. It's built as
+ * a small tree of references into the StrDict, so no values are copied
+ * and no Perl data is created.
+ *
+ * All values are strings, as they are in the hash. Non-ASCII values are
+ * written as they are if they're UTF-8, and converted from Latin-1 if
+ * not, which is how a JSON encoder treats flagged and unflagged Perl
+ * strings.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <clientapi.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include "perlheaders.h"
+#include "p4utf8.h"
+#include "p4ndjson.h"
+
+struct P4JsonNode
+{
+	StrRef				value;
+	int				isArray;
+	std::vector<P4JsonNode *>	items;
+};
+
+class P4JsonRecord
+{
+    public:
+	P4JsonNode *	Leaf( const StrPtr &val );
+	P4JsonNode *	Array();
+
+	P4JsonNode *	Find( const std::string &key );
+	void		Store( const std::string &key, P4JsonNode *n );
+
+	void		Insert( const StrPtr &var, const StrPtr &val );
+	void		Write( int utf8, StrBuf &out );
+
+    private:
+	static void	SplitKey( const StrPtr &key, StrBuf &base, 
+				StrBuf &index );
+	static P4JsonNode **
+			Slot( P4JsonNode *a, int i );
+	void		WriteNode( P4JsonNode *n, int utf8, StrBuf &out );
+
+	std::deque<P4JsonNode>	pool;
+	std::vector<std::pair<std::string, P4JsonNode *> >	fields;
+	std::map<std::string, size_t>				where;
+};
+
+P4JsonNode *
+P4JsonRecord::Leaf( const StrPtr &val )
+{
+	pool.push_back( P4JsonNode() );
+	P4JsonNode *n = &pool.back();
+	n->value.Set( val.Text(), val.Length() );
+	n->isArray = 0;
+	return n;
+}
+
+P4JsonNode *
+P4JsonRecord::Array()
+{
+	pool.push_back( P4JsonNode() );
+	P4JsonNode *n = &pool.back();
+	n->isArray = 1;
+	return n;
+}
+
+P4JsonNode *
+P4JsonRecord::Find( const std::string &key )
+{
+	std::map<std::string, size_t>::iterator i = where.find( key );
+	return i == where.end() ? 0 : fields[ i->second ].second;
+}
+
+void
+P4JsonRecord::Store( const std::string &key, P4JsonNode *n )
+{
+	std::map<std::string, size_t>::iterator i = where.find( key );
+	if( i != where.end() )
+	{
+	    fields[ i->second ].second = n;
+	    return;
+	}
+	where[ key ] = fields.size();
+	fields.push_back( std::make_pair( key, n ) );
+}
+
+// As SpecMgr::SplitKey(): the index is the trailing digits and commas
+void
+P4JsonRecord::SplitKey( const StrPtr &key, StrBuf &base, StrBuf &index )
+{
+	base = key;
+	index = "";
+	for( int i = key.Length(); i; i-- )
+	{
+	    char prev = key[ i - 1 ];
+	    if( !isdigit( (unsigned char) prev ) && prev != ',' )
+	    {
+		base.Set( key.Text(), i );
+		index.Set( key.Text() + i );
+		break;
+	    }
+	}
+}
+
+// The entry at i in an array, growing it with nulls as need be
+P4JsonNode **
+P4JsonRecord::Slot( P4JsonNode *a, int i )
+{
+	if( (size_t) i >= a->items.size() )
+	    a->items.resize( i + 1, (P4JsonNode *) 0 );
+	return &a->items[ i ];
+}
+
+//
+// Follows SpecMgr::InsertItem() case for case.
+//
+void
+P4JsonRecord::Insert( const StrPtr &var, const StrPtr &val )
+{
+	StrBuf base, index;
+
+	SplitKey( var, base, index );
+
+	// No index: a plain value, renamed if the key's already taken
+	if( index == "" )
+	{
+	    std::string key( base.Text(), base.Length() );
+	    if( Find( key ) )
+		key += "s";
+	    Store( key, Leaf( val ) );
+	    return;
+	}
+
+	std::string key( base.Text(), base.Length() );
+	P4JsonNode *a = Find( key );
+
+	if( !a )
+	{
+	    a = Array();
+	    Store( key, a );
+	}
+	else if( !a->isArray )
+	{
+	    // A name collision: keep the raw variable name
+	    Store( std::string( var.Text(), var.Length() ), Leaf( val ) );
+	    return;
+	}
+
+	// Each level of a comma separated index is a nested array
+	const char *p = index.Text();
+	const char *c;
+
+	while( ( c = strchr( p, ',' ) ) )
+	{
+	    P4JsonNode **s = Slot( a, atoi( p ) );
+
+	    if( !*s )
+		*s = Array();
+	    else if( !(*s)->isArray )
+		return;		// InsertItem warns and drops these too
+
+	    a = *s;
+	    p = c + 1;
+	}
+
+	*Slot( a, atoi( p ) ) = Leaf( val );
+}
+
+void
+P4JsonRecord::Write( int utf8, StrBuf &out )
+{
+	out << "{";
+	for( size_t i = 0; i < fields.size(); i++ )
+	{
+	    if( i )
+		out << ",";
+
+	    StrRef key( fields[ i ].first.c_str(), fields[ i ].first.size() );
+	    P4Ndjson::Quote( key, utf8, out );
+	    out << ":";
+	    WriteNode( fields[ i ].second, utf8, out );
+	}
+	out << "}\n";
+}
+
+void
+P4JsonRecord::WriteNode( P4JsonNode *n, int utf8, StrBuf &out )
+{
+	if( !n )
+	{
+	    out << "null";
+	    return;
+	}
+
+	if( !n->isArray )
+	{
+	    P4Ndjson::Quote( n->value, utf8, out );
+	    return;
+	}
+
+	out << "[";
+	for( size_t i = 0; i < n->items.size(); i++ )
+	{
+	    if( i )
+		out << ",";
+	    WriteNode( n->items[ i ], utf8, out );
+	}
+	out << "]";
+}
+
+void
+P4Ndjson::Format( StrDict *dict, int utf8, StrBuf &out )
+{
+	P4JsonRecord r;
+	StrRef var, val;
+
+	for( int i = 0; dict->GetVar( i, var, val ); i++ )
+	{
+	    if( var == "specdef" || var == "func" || var == "specFormatted" )
+		continue;
+
+	    r.Insert( var, val );
+	}
+
+	r.Write( utf8, out );
+}
+
+void
+P4Ndjson::Quote( const StrPtr &s, int utf8, StrBuf &out )
+{
+	static const char hex[] = "0123456789abcdef";
+	const unsigned char *p = (const unsigned char *) s.Text();
+	const unsigned char *e = p + s.Length();
+	const unsigned char *run = p;
+
+	int latin1 = !P4Utf8::IsAscii( s.Text(), s.Length() ) &&
+		( utf8 == P4Utf8::BYTES || ( utf8 == P4Utf8::VALIDATE &&
+		  !is_utf8_string( (U8 *) s.Text(), s.Length() ) ) );
+
+	out << "\"";
+	for( ; p < e; p++ )
+	{
+	    // Most characters go out as they are, in runs
+	    if( *p >= 0x20 && *p != '"' && *p != '\\' && 
+		    ( *p < 0x80 || !latin1 ) )
+		continue;
+
+	    out.Append( (const char *) run, p - run );
+	    run = p + 1;
+
+	    char esc[ 6 ];
+	    switch( *p )
+	    {
+	    case '"':	out << "\\\""; break;
+	    case '\\':	out << "\\\\"; break;
+	    case '\n':	out << "\\n"; break;
+	    case '\r':	out << "\\r"; break;
+	    case '\t':	out << "\\t"; break;
+	    case '\b':	out << "\\b"; break;
+	    case '\f':	out << "\\f"; break;
+	    default:
+		if( *p < 0x20 )
+		{
+		    esc[ 0 ] = '\\'; esc[ 1 ] = 'u';
+		    esc[ 2 ] = '0'; esc[ 3 ] = '0';
+		    esc[ 4 ] = hex[ *p >> 4 ]; esc[ 5 ] = hex[ *p & 0xf ];
+		}
+		else
+		{
+		    // A Latin-1 character as its two byte UTF-8 sequence
+		    esc[ 0 ] = (char) ( 0xc0 | ( *p >> 6 ) );
+		    esc[ 1 ] = (char) ( 0x80 | ( *p & 0x3f ) );
+		    out.Append( esc, 2 );
+		    break;
+		}
+		out.Append( esc, 6 );
+	    }
+	}
+	out.Append( (const char *) run, p - run );
+	out << "\"";
+}
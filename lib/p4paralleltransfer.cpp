@@ -0,0 +1,454 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4paralleltransfer.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: ClientTransfer implementation for parallel sync, shelve
+ * 		  and submit.
+ *
+ * When a command is run with --parallel (or net.parallel.threads is set)
+ * the server asks the client to start 'threads' extra commands, usually
+ * 'transmit', each on its own connection, and waits for them to move the
+ * files. The command line client forks a process for each one; we start
+ * a thread with its own ClientApi instead.
+ *
+ * The worker threads must never touch the Perl interpreter, so they run
+ * with a plain C++ ClientUser that discards output, records errors and
+ * copies progress into a shared slot. The calling thread polls those
+ * slots and passes each worker's progress on to the P4::Progress object
+ * (through the ClientProgress the PerlClientUser creates), and reports
+ * any errors once all the workers have finished. If the progress object
+ * asks for the command to be cancelled, the workers are told to stop.
+ *
+ ******************************************************************************/
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <clientapi.h>
+#include <clientprog.h>
+#include <strarray.h>
+#include "perlheaders.h"
+#include "p4perldebug.h"
+#include "p4synciopolicy.h"
+#include "p4paralleltransfer.h"
+
+/*
+ * State shared between a worker thread and the calling thread. Guarded by
+ * 'lock'; 'generation' is bumped each time the worker starts a new
+ * ClientProgress so the caller knows to start a new one too.
+ */
+struct P4TransferSlot
+{
+	std::mutex	lock;
+
+	int		generation;
+	int		type;
+	StrBuf		desc;
+	int		units;
+	long		total;
+	long		position;
+	int		done;
+	int		fail;
+
+	StrBuf		errors;
+	int		finished;
+
+	P4TransferSlot()
+	{
+	    generation = type = units = done = fail = finished = 0;
+	    total = position = 0;
+	}
+};
+
+class P4TransferProgress : public ClientProgress
+{
+    public:
+	P4TransferProgress( P4TransferSlot *s, int type ) : slot( s )
+	{
+	    std::lock_guard<std::mutex> g( slot->lock );
+	    slot->generation++;
+	    slot->type = type;
+	    slot->desc.Clear();
+	    slot->units = 0;
+	    slot->total = slot->position = 0;
+	    slot->done = slot->fail = 0;
+	}
+
+	void Description( const StrPtr *d, int units )
+	{
+	    std::lock_guard<std::mutex> g( slot->lock );
+	    slot->desc.Set( d );
+	    slot->units = units;
+	}
+
+	void Total( long t )
+	{
+	    std::lock_guard<std::mutex> g( slot->lock );
+	    slot->total = t;
+	}
+
+	int Update( long p )
+	{
+	    std::lock_guard<std::mutex> g( slot->lock );
+	    slot->position = p;
+	    return 0;
+	}
+
+	void Done( int f )
+	{
+	    std::lock_guard<std::mutex> g( slot->lock );
+	    slot->done = 1;
+	    slot->fail = f;
+	}
+
+    private:
+	P4TransferSlot	*slot;
+};
+
+class P4TransferUser : public ClientUser, public KeepAlive
+{
+    public:
+	P4TransferUser( P4TransferSlot *s, std::atomic<int> *c, int p,
+			P4SyncIOPolicy *io )
+		: slot( s ), cancel( c ), progress( p ), policy( io ) {}
+
+	FileSys *File( FileSysType type )
+	{
+	    return policy ? policy->File( type, varList ) 
+			  : ClientUser::File( type );
+	}
+
+	void	OutputInfo( char level, const char *data ) {}
+	void	OutputText( const char *data, int length ) {}
+	void	OutputBinary( const char *data, int length ) {}
+	void	OutputStat( StrDict *varList ) {}
+
+	void	Message( Error *e )
+	{
+	    if( e->GetSeverity() >= E_FAILED )
+		HandleError( e );
+	}
+
+	void	HandleError( Error *e )
+	{
+	    StrBuf t;
+	    e->Fmt( t, EF_PLAIN );
+	    OutputError( t.Text() );
+	}
+
+	void	OutputError( const char *errBuf )
+	{
+	    std::lock_guard<std::mutex> g( slot->lock );
+	    slot->errors.Append( errBuf );
+	}
+
+	int	ProgressIndicator() { return progress; }
+
+	ClientProgress *CreateProgress( int type )
+	{
+	    return progress ? new P4TransferProgress( slot, type ) : 0;
+	}
+
+	int	IsAlive() { return !cancel->load(); }
+
+    private:
+	P4TransferSlot		*slot;
+	std::atomic<int>	*cancel;
+	int			progress;
+	P4SyncIOPolicy		*policy;
+};
+
+/*
+ * Everything a worker needs, copied from the calling thread before the
+ * workers start: nothing in the parent's ClientApi is touched afterwards.
+ */
+struct P4TransferJob
+{
+	StrBuf		port, user, client, password, host, cwd;
+	StrBuf		charset, prog, version, ticketFile, trustFile;
+	int		trans;
+	StrBufDict	protocol;
+	StrBuf		cmd;
+	std::vector<StrBuf>	args;
+	int		progress;
+	P4SyncIOPolicy	*policy;
+	std::atomic<int>	cancel;
+};
+
+static void
+RunWorker( P4TransferJob *job, P4TransferSlot *slot )
+{
+	ClientApi	client;
+	P4TransferUser	ui( slot, &job->cancel, job->progress, job->policy );
+	Error		e;
+	StrRef		var, val;
+
+	for( int i = 0; job->protocol.GetVar( i, var, val ); i++ )
+	    client.SetProtocol( var.Text(), val.Text() );
+
+	client.SetPort( &job->port );
+	client.SetUser( &job->user );
+	client.SetClient( &job->client );
+	client.SetHost( &job->host );
+	client.SetCwdNoReload( job->cwd.Text() );
+	client.SetProg( &job->prog );
+	client.SetVersion( &job->version );
+	if( job->password.Length() )
+	    client.SetPassword( &job->password );
+	if( job->ticketFile.Length() )
+	    client.SetTicketFile( job->ticketFile.Text() );
+	if( job->trustFile.Length() )
+	    client.SetTrustFile( job->trustFile.Text() );
+	if( job->charset.Length() )
+	{
+	    client.SetCharset( &job->charset );
+	    client.SetTrans( job->trans );
+	}
+
+	client.SetBreak( &ui );
+	client.Init( &e );
+
+	if( !e.Test() )
+	{
+	    std::vector<char *> argv;
+	    for( size_t i = 0; i < job->args.size(); i++ )
+		argv.push_back( job->args[ i ].Text() );
+
+	    client.SetArgv( (int)argv.size(), argv.data() );
+	    client.Run( job->cmd.Text(), &ui );
+	    client.Final( &e );
+	}
+
+	if( e.Test() )
+	    ui.HandleError( &e );
+
+	std::lock_guard<std::mutex> g( slot->lock );
+	slot->finished = 1;
+}
+
+P4ParallelTransfer::P4ParallelTransfer()
+{
+	debug = 0;
+	policy = 0;
+}
+
+P4ParallelTransfer::~P4ParallelTransfer()
+{
+}
+
+int
+P4ParallelTransfer::Transfer( ClientApi *client, ClientUser *ui,
+		const char *cmd, StrArray &args, StrDict &pVars,
+		int threads, Error *e )
+{
+	if( threads < 1 )
+	    threads = 1;
+
+	if( P4PERL_DEBUG_CMDS )
+	    PerlIO_stdoutf( "[P4ParallelTransfer::Transfer]: %s on %d threads\n",
+		    cmd, threads );
+
+	P4TransferJob job;
+	StrRef var, val;
+
+	job.port = client->GetPort();
+	job.user = client->GetUser();
+	job.client = client->GetClient();
+	job.password = client->GetPassword();
+	job.host = client->GetHost();
+	job.cwd = client->GetCwd();
+	job.charset = client->GetCharset();
+	job.prog = client->GetProg();
+	job.version = client->GetVersion();
+	job.ticketFile = client->GetTicketFile();
+	job.trustFile = client->GetTrustFile();
+	job.trans = client->GetTrans();
+	job.cmd = cmd;
+	job.progress = ui->ProgressIndicator();
+	job.policy = policy;
+	job.cancel = 0;
+
+	for( int i = 0; pVars.GetVar( i, var, val ); i++ )
+	    job.protocol.SetVar( var, val );
+	for( int i = 0; i < args.Count(); i++ )
+	    job.args.push_back( *args.Get( i ) );
+
+	std::vector<P4TransferSlot> slots( threads );
+	std::vector<std::thread> workers;
+
+	try
+	{
+	    for( int i = 0; i < threads; i++ )
+		workers.push_back( std::thread( RunWorker, &job, &slots[ i ] ) );
+	}
+	catch( ... )
+	{
+	    // Couldn't start them all: let those we have do the work.
+	    if( workers.empty() )
+	    {
+		e->Set( E_FAILED, "Unable to start parallel transfer threads." );
+		return 1;
+	    }
+	    threads = (int)workers.size();
+	}
+
+	//
+	// Forward progress until every worker has finished. Each worker's
+	// progress is presented to Perl as a separate ClientProgress, with
+	// the thread number added to its description.
+	//
+	std::vector<ClientProgress *> progress( threads, (ClientProgress *)0 );
+	std::vector<int> seen( threads, 0 );
+	std::vector<int> closed( threads, 0 );
+
+	// What each progress object has been told, so that a description
+	// or total set after we first saw the file is still passed on
+	std::vector<StrBuf> sentDesc( threads );
+	std::vector<int> sentUnits( threads, -1 );
+	std::vector<long> sentTotal( threads, 0 );
+	int running = threads;
+
+	//
+	// The caller's ui is also its break handler: once it stops being
+	// alive (a handler asked to cancel, say) the workers are told too,
+	// whether or not there's a progress object to ask.
+	//
+	KeepAlive *parent = dynamic_cast<KeepAlive *>( ui );
+
+	while( running )
+	{
+	    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+
+	    if( parent && !parent->IsAlive() )
+		job.cancel = 1;
+
+	    running = 0;
+	    for( int i = 0; i < threads; i++ )
+	    {
+		P4TransferSlot &s = slots[ i ];
+		int gen, type, units, done, fail, finished;
+		long total, position;
+		StrBuf desc;
+
+		{
+		    std::lock_guard<std::mutex> g( s.lock );
+		    gen = s.generation;
+		    type = s.type;
+		    units = s.units;
+		    done = s.done;
+		    fail = s.fail;
+		    total = s.total;
+		    position = s.position;
+		    finished = s.finished;
+		    desc = s.desc;
+		}
+
+		if( !finished )
+		    running++;
+
+		if( !job.progress || !gen )
+		    continue;
+
+		if( gen != seen[ i ] )
+		{
+		    if( progress[ i ] && !closed[ i ] )
+			progress[ i ]->Done( 0 );
+		    delete progress[ i ];
+
+		    progress[ i ] = ui->CreateProgress( type );
+		    seen[ i ] = gen;
+		    closed[ i ] = 0;
+		    sentDesc[ i ].Clear();
+		    sentUnits[ i ] = -1;
+		    sentTotal[ i ] = 0;
+		}
+
+		if( !progress[ i ] || closed[ i ] )
+		    continue;
+
+		if( units != sentUnits[ i ] || desc != sentDesc[ i ] )
+		{
+		    StrBuf d;
+		    d << "[" << ( i + 1 ) << "] " << desc;
+		    progress[ i ]->Description( &d, units );
+		    sentDesc[ i ] = desc;
+		    sentUnits[ i ] = units;
+		}
+
+		if( total != sentTotal[ i ] )
+		{
+		    progress[ i ]->Total( total );
+		    sentTotal[ i ] = total;
+		}
+
+		if( progress[ i ]->Update( position ) )
+		    job.cancel = 1;
+
+		if( done )
+		{
+		    progress[ i ]->Done( fail );
+		    closed[ i ] = 1;
+		}
+	    }
+	}
+
+	for( size_t i = 0; i < workers.size(); i++ )
+	    workers[ i ].join();
+
+	for( int i = 0; i < threads; i++ )
+	{
+	    if( progress[ i ] && !closed[ i ] )
+		progress[ i ]->Done( slots[ i ].errors.Length() > 0 );
+	    delete progress[ i ];
+	}
+
+	//
+	// Report what went wrong. The text goes in as an argument rather
+	// than as the format so a stray '%' in a path survives.
+	//
+	StrBuf errors;
+	for( int i = 0; i < threads; i++ )
+	    errors.Append( &slots[ i ].errors );
+
+	if( job.cancel.load() && !errors.Length() )
+	    errors = "Parallel transfer cancelled.";
+
+	if( errors.Length() )
+	{
+	    e->Set( E_FAILED, "%errors%" );
+	    *e << errors;
+	    return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4paralleltransfer.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: ClientTransfer implementation for parallel sync, shelve
+ * 		  and submit. Files are moved over extra connections, one
+ * 		  per thread, with their progress reported back to Perl.
+ *
+ ******************************************************************************/
+
+class P4SyncIOPolicy;
+
+class P4ParallelTransfer : public ClientTransfer
+{
+    public:
+			P4ParallelTransfer();
+	virtual		~P4ParallelTransfer();
+
+	int		Transfer( ClientApi *client, ClientUser *ui,
+				const char *cmd, StrArray &args,
+				StrDict &pVars, int threads, Error *e );
+
+	void		SetDebugLevel( int d ) { debug = d; }
+
+	// Applied to the workers' files; set per command
+	void		SetSyncIOPolicy( P4SyncIOPolicy *p ) { policy = p; }
+
+    private:
+	int		debug;
+	P4SyncIOPolicy	*policy;
+};
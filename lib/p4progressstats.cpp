@@ -0,0 +1,162 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4progressstats.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Native record of the progress reported by the Perforce
+ * 		  API, one entry per progress type.
+ *
+ ******************************************************************************/
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4perltimer.h"
+#include "p4progressstats.h"
+
+P4ProgressStats::P4ProgressStats()
+{
+    Reset();
+}
+
+void
+P4ProgressStats::Reset()
+{
+    for( int i = 0; i < MAX_TYPES; i++ )
+    {
+	Record &r = records[ i ];
+
+	r.used = 0;
+	r.description.Clear();
+	r.units = 0;
+	r.total = 0;
+	r.position = 0;
+	r.start = 0;
+	r.end = 0;
+	r.done = 0;
+	r.fail = 0;
+    }
+}
+
+P4ProgressStats::Record *
+P4ProgressStats::Get( int type )
+{
+    if( type < 0 || type >= MAX_TYPES )
+	return 0;
+    return &records[ type ];
+}
+
+//
+// A progress type may be reported more than once in a command (e.g. one
+// computation phase after another), so Init() starts the record afresh.
+//
+void
+P4ProgressStats::Init( int type )
+{
+    Record *r = Get( type );
+    if( !r ) return;
+
+    r->used = 1;
+    r->description.Clear();
+    r->units = 0;
+    r->total = 0;
+    r->position = 0;
+    r->start = P4PerlTimer::Now();
+    r->end = 0;
+    r->done = 0;
+    r->fail = 0;
+}
+
+void
+P4ProgressStats::Description( int type, const StrPtr *desc, int units )
+{
+    Record *r = Get( type );
+    if( !r ) return;
+
+    if( desc )
+	r->description.Set( desc );
+    r->units = units;
+}
+
+void
+P4ProgressStats::Total( int type, long total )
+{
+    Record *r = Get( type );
+    if( r ) r->total = total;
+}
+
+void
+P4ProgressStats::Update( int type, long position )
+{
+    Record *r = Get( type );
+    if( r ) r->position = position;
+}
+
+void
+P4ProgressStats::Done( int type, int fail )
+{
+    Record *r = Get( type );
+    if( !r ) return;
+
+    r->done = 1;
+    r->fail = fail;
+    r->end = P4PerlTimer::Now();
+}
+
+HV *
+P4ProgressStats::ToHash()
+{
+    HV *	hv = newHV();
+    char	key[ 16 ];
+
+    for( int i = 0; i < MAX_TYPES; i++ )
+    {
+	Record &r = records[ i ];
+	if( !r.used ) continue;
+
+	double elapsed = ( r.done ? r.end : P4PerlTimer::Now() ) - r.start;
+	double rate = elapsed > 0 ? r.position / elapsed : 0;
+
+	HV * h = newHV();
+	hv_store( h, "Type", 4, newSViv( i ), 0 );
+	hv_store( h, "Description", 11, 
+		newSVpv( r.description.Text(), r.description.Length() ), 0 );
+	hv_store( h, "Units", 5, newSViv( r.units ), 0 );
+	hv_store( h, "Total", 5, newSViv( r.total ), 0 );
+	hv_store( h, "Position", 8, newSViv( r.position ), 0 );
+	hv_store( h, "Elapsed", 7, newSVnv( elapsed ), 0 );
+	hv_store( h, "Rate", 4, newSVnv( rate ), 0 );
+	hv_store( h, "Done", 4, newSViv( r.done ), 0 );
+	hv_store( h, "Failed", 6, newSViv( r.fail ), 0 );
+
+	sprintf( key, "%d", i );
+	hv_store( hv, key, strlen( key ), newRV_noinc( (SV*) h ), 0 );
+    }
+    return hv;
+}
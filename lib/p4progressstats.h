@@ -0,0 +1,75 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4progressstats.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Native record of the progress reported by the Perforce
+ * 		  API, one entry per progress type, which can be read from
+ * 		  Perl without any progress callbacks being made.
+ *
+ ******************************************************************************/
+
+class P4ProgressStats
+{
+    public:
+			P4ProgressStats();
+
+	void		Reset();
+
+	void		Init( int type );
+	void		Description( int type, const StrPtr *desc, int units );
+	void		Total( int type, long total );
+	void		Update( int type, long position );
+	void		Done( int type, int fail );
+
+	// Returns a new hash keyed on progress type
+	HV *		ToHash();
+
+    private:
+	enum { MAX_TYPES = 8 };
+
+	struct Record
+	{
+	    int		used;
+	    StrBuf	description;
+	    int		units;
+	    long	total;
+	    long	position;
+	    double	start;
+	    double	end;
+	    int		done;
+	    int		fail;
+	};
+
+	Record *	Get( int type );
+
+	Record		records[ MAX_TYPES ];
+};
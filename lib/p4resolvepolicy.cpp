@@ -0,0 +1,269 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4resolvepolicy.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Table of path patterns and resolve actions, evaluated
+ * 		  without calling into Perl.
+ *
+ * The patterns go into a single MapApi, each mapped to a right hand side
+ * that encodes its position in the table: '//depot/gen/...' as rule 3
+ * becomes '//depot/gen/... //3/...'. Looking a file up is then one
+ * Translate() however long the table, and the table behaves like any
+ * other Perforce mapping: later rules override earlier ones, and a
+ * pattern starting with '-' excludes files from the rules above it.
+ *
+ * A file is looked up by the target's name in client syntax and then by
+ * the source's name in depot syntax, less its revision, so patterns can
+ * be written in either. Files that match nothing go to the resolver.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include <stdlib.h>
+#include <clientapi.h>
+#include <mapapi.h>
+#include "perlheaders.h"
+#include "p4resolvepolicy.h"
+
+P4ResolvePolicy::P4ResolvePolicy()
+{
+	map = new MapApi;
+	actions = 0;
+	count = 0;
+}
+
+P4ResolvePolicy::~P4ResolvePolicy()
+{
+	delete map;
+	delete [] actions;
+}
+
+int
+P4ResolvePolicy::ParseAction( const char *a, Action &action )
+{
+	if( !strcmp( a, "am" ) )		action = ACCEPT_MERGED;
+	else if( !strcmp( a, "at" ) )		action = ACCEPT_THEIRS;
+	else if( !strcmp( a, "ay" ) )		action = ACCEPT_YOURS;
+	else if( !strcmp( a, "s" ) )		action = SKIP;
+	else if( !strcmp( a, "perl" ) )		action = RESOLVER;
+	else return 0;
+	return 1;
+}
+
+int
+P4ResolvePolicy::Configure( AV * rules, int caseSensitive )
+{
+	int n = av_len( rules ) + 1;
+
+	if( n % 2 )
+	{
+	    warn( "Resolve policy must be a list of pattern => action pairs" );
+	    return 0;
+	}
+
+	map->Clear();
+	map->SetCaseSensitivity( caseSensitive ? MapCaseSensitive 
+					       : MapCaseInsensitive );
+	delete [] actions;
+	actions = new Action[ n / 2 + 1 ];
+	count = 0;
+
+	for( int i = 0; i < n; i += 2 )
+	{
+	    SV ** p = av_fetch( rules, i, 0 );
+	    SV ** a = av_fetch( rules, i + 1, 0 );
+
+	    if( !p || !a || !SvOK( *p ) || !SvOK( *a ) 
+		    || !ParseAction( SvPV_nolen( *a ), actions[ count ] ) )
+	    {
+		warn( "Invalid resolve policy rule %d: actions are "
+			"am, at, ay, s and perl", i / 2 + 1 );
+		map->Clear();
+		count = 0;
+		return 0;
+	    }
+
+	    const char *pat = SvPV_nolen( *p );
+	    MapType type = MapInclude;
+	    if( *pat == '-' )
+	    {
+		type = MapExclude;
+		pat++;
+	    }
+	    else if( *pat == '+' )
+	    {
+		pat++;
+	    }
+
+	    //
+	    // The right hand side needs the same wildcards as the left,
+	    // in the same order; after them it's just the rule number.
+	    //
+	    StrBuf lhs, rhs;
+	    lhs.Set( pat );
+	    int wild = 0;
+	    rhs << "//" << count;
+	    for( const char *c = pat; *c; wild++ )
+	    {
+		if( !strncmp( c, "...", 3 ) )
+		{
+		    rhs << "/...";
+		    c += 3;
+		}
+		else if( *c == '*' )
+		{
+		    rhs << "/*";
+		    c++;
+		}
+		else if( c[ 0 ] == '%' && c[ 1 ] == '%' && c[ 2 ] )
+		{
+		    rhs << "/%%";
+		    rhs.Extend( c[ 2 ] );
+		    rhs.Terminate();
+		    c += 3;
+		}
+		else
+		{
+		    c++;
+		    wild--;
+		}
+	    }
+	    if( !wild )
+		rhs << "/x";
+
+	    map->Insert( lhs, rhs, type );
+	    count++;
+	}
+	return 1;
+}
+
+P4ResolvePolicy::Action
+P4ResolvePolicy::Lookup( const StrPtr &name )
+{
+	StrBuf to;
+
+	if( !name.Length() || !map->Translate( name, to ) )
+	    return UNMATCHED;
+
+	int rule = atoi( to.Text() + 2 );
+	return rule >= 0 && rule < count ? actions[ rule ] : UNMATCHED;
+}
+
+//
+// Try the target in client syntax, then the source in depot syntax. For
+// action resolves the names aren't in the message, but the tagged output
+// record describing the resolve has them.
+//
+P4ResolvePolicy::Action
+P4ResolvePolicy::Lookup( StrDict *vars, SV *info )
+{
+	StrBuf names[ 2 ];
+	StrPtr *v;
+
+	if( vars && ( v = vars->GetVar( "yourName" ) ) )
+	    names[ 0 ] = *v;
+	if( vars && ( v = vars->GetVar( "theirName" ) ) )
+	    names[ 1 ] = *v;
+
+	if( info && SvROK( info ) && SvTYPE( SvRV( info ) ) == SVt_PVHV )
+	{
+	    HV * hv = (HV *) SvRV( info );
+	    SV ** s;
+	    if( !names[ 0 ].Length() 
+		    && ( s = hv_fetch( hv, "clientFile", 10, 0 ) ) )
+		names[ 0 ] = SvPV_nolen( *s );
+	    if( !names[ 1 ].Length() 
+		    && ( s = hv_fetch( hv, "fromFile", 8, 0 ) ) )
+		names[ 1 ] = SvPV_nolen( *s );
+	}
+
+	// No revisions in the patterns
+	const char *hash = strchr( names[ 1 ].Text(), '#' );
+	if( hash )
+	    names[ 1 ].SetLength( hash - names[ 1 ].Text() );
+
+	for( int i = 0; i < 2; i++ )
+	{
+	    Action a = Lookup( names[ i ] );
+	    if( a != UNMATCHED )
+		return a;
+	}
+	return RESOLVER;
+}
+
+int
+P4ResolvePolicy::Decide( ClientMerge *m, StrDict *vars, MergeStatus &status )
+{
+	switch( Lookup( vars, 0 ) )
+	{
+	case ACCEPT_MERGED:
+	    // As 'resolve -am': take the merger's automatic choice, and
+	    // leave conflicts - including binary files changed on both
+	    // sides, which have no chunks to count - to the resolver
+	    status = m->AutoResolve( CMF_AUTO );
+	    return status != CMS_SKIP && status != CMS_EDIT;
+	case ACCEPT_THEIRS:
+	    status = CMS_THEIRS;
+	    return 1;
+	case ACCEPT_YOURS:
+	    status = CMS_YOURS;
+	    return 1;
+	case SKIP:
+	    status = CMS_SKIP;
+	    return 1;
+	default:
+	    return 0;
+	}
+}
+
+int
+P4ResolvePolicy::Decide( ClientResolveA *m, StrDict *vars, SV *info,
+		MergeStatus &status )
+{
+	switch( Lookup( vars, info ) )
+	{
+	case ACCEPT_MERGED:
+	    // Only where the merger thinks it safe, else ask the resolver
+	    status = m->AutoResolve( CMF_SAFE );
+	    return status != CMS_SKIP && status != CMS_EDIT;
+	case ACCEPT_THEIRS:
+	    status = CMS_THEIRS;
+	    return 1;
+	case ACCEPT_YOURS:
+	    status = CMS_YOURS;
+	    return 1;
+	case SKIP:
+	    status = CMS_SKIP;
+	    return 1;
+	default:
+	    return 0;
+	}
+}
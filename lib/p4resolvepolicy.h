@@ -0,0 +1,75 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4resolvepolicy.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Table of path patterns and resolve actions, evaluated
+ * 		  without calling into Perl.
+ *
+ ******************************************************************************/
+
+class MapApi;
+
+class P4ResolvePolicy
+{
+    public:
+	enum Action {
+	    UNMATCHED = -1,
+	    RESOLVER,		// call the P4::Resolver, as without a policy
+	    ACCEPT_MERGED,	// 'am': only if there are no conflicts
+	    ACCEPT_THEIRS,	// 'at'
+	    ACCEPT_YOURS,	// 'ay'
+	    SKIP		// 's'
+	};
+
+			P4ResolvePolicy();
+			~P4ResolvePolicy();
+
+	// rules is [ pattern => action, ... ]. Returns 0, with a warning,
+	// if any of it can't be understood.
+	int		Configure( AV * rules, int caseSensitive );
+
+	// Settle a resolve if the policy says how. Returns 0 if it's one
+	// for the resolver.
+	int		Decide( ClientMerge *m, StrDict *vars, 
+				MergeStatus &status );
+	int		Decide( ClientResolveA *m, StrDict *vars, SV *info,
+				MergeStatus &status );
+
+    private:
+	Action		Lookup( const StrPtr &name );
+	Action		Lookup( StrDict *vars, SV *info );
+	static int	ParseAction( const char *a, Action &action );
+
+	MapApi *	map;
+	Action *	actions;
+	int		count;
+};
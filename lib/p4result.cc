@@ -37,9 +37,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "perlheaders.h"
 #include "p4perldebug.h"
 #include "p4result.h"
+#include "p4utf8.h"
 
 P4Result::P4Result() {
     debug  = 0;
+    utf8Mode = 0;
     apiLevel = atoi(P4Tag::l_client);
     Init();
 }
@@ -87,6 +89,27 @@ void P4Result::Reset() {
     Init();
 }
 
+//
+// Output is pushed one record at a time, and growing the array in small
+// steps means reallocating it over and over for large results. When we
+// have an idea of how many records to expect, allocate the space up
+// front. The hint is capped so that an optimistic guess (e.g. -m with a
+// huge value) can't cost much.
+//
+static const I32 maxSizeHint = 65536;
+
+void P4Result::SetSizeHint(I32 n) {
+    if( n <= 0 )
+	return;
+    if( n > maxSizeHint )
+	n = maxSizeHint;
+
+    if( P4PERL_DEBUG_DATA )
+	PerlIO_stdoutf( "[P4Result::SetSizeHint]: %d\n", (int) n );
+
+    av_extend( output, n - 1 );
+}
+
 void P4Result::AddOutput(SV * out) {
     if( P4PERL_DEBUG_DATA )
 	PerlIO_stdoutf( "[P4Result::AddOutput]: (perl object)\n" );
@@ -118,7 +141,9 @@ void P4Result::AddMessage(Error *e) {
     else
     	dest = errors;
 
-    av_push( dest, newSVpv( m.Text(), m.Length() ) );
+    SV *text = newSVpv( m.Text(), m.Length() );
+    P4Utf8::Mark( text, utf8Mode );
+    av_push( dest, text );
 
     // 
     // Now create a P4::Error object and insert it into the messages array.
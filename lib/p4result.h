@@ -48,6 +48,9 @@ public:
 	void AddTrack(SV *t);
 	void DeleteTrack();
 
+	// Pre-size the output array for the expected number of results
+	void SetSizeHint(I32 n);
+
 	// Getting
 	AV * GetOutput();
 	AV * GetErrors() {
@@ -82,6 +85,11 @@ public:
 		apiLevel = l;
 	}
 
+	// Flag messages as UTF-8; see P4Utf8::Mode
+	void SetUtf8Mode(int m) {
+		utf8Mode = m;
+	}
+
 	// Debugging Support
 	void SetDebugLevel(int i) {
 		debug = i;
@@ -94,6 +102,7 @@ private:
 private:
 	int debug;
 	int apiLevel;
+	int utf8Mode;
 	AV *output;
 	AV *warnings;
 	AV *messages;
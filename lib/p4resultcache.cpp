@@ -0,0 +1,435 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4resultcache.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: A size-bounded, in-memory cache of the results of
+ * 		  commands whose output can never change.
+ *
+ * Only a handful of commands qualify, and only when every file argument
+ * is in depot syntax and names a fixed point in history:
+ *
+ *	//depot/path#N		a single revision (no wildcards)
+ *	//depot/path/...@=N	the revisions submitted in change N
+ *
+ * Anything else - @N, #head, @label, ranges, client or local syntax -
+ * can give different answers over time and isn't cached. On top of
+ * that, the output has to pass some checks before it's stored: describe
+ * must report a submitted change, fstat must not include any fields that
+ * reflect the state of a workspace, and empty output or output with
+ * warnings or errors is never stored (e.g. @=N of a change that hasn't
+ * been submitted yet).
+ *
+ * filelog isn't cached even for fixed revisions as its output grows when
+ * those revisions are later integrated elsewhere.
+ *
+ ******************************************************************************/
+#include <string>
+#include <map>
+#include <string.h>
+#include <ctype.h>
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4result.h"
+#include "p4runmemory.h"
+#include "p4resultcache.h"
+
+struct P4ResultCacheEntry
+{
+    AV *		output;
+    long		size;
+    unsigned long	used;
+};
+
+struct P4ResultCacheEntries : public std::map<std::string, P4ResultCacheEntry>
+{
+};
+
+typedef P4ResultCacheEntries::iterator P4ResultCacheIter;
+
+static std::string
+CacheKey( const StrPtr &ident, const char *cmd, int argc, char * const *argv )
+{
+    std::string key( ident.Text(), ident.Length() );
+
+    key += '\0';
+    key += cmd;
+    for( int i = 0; i < argc; i++ )
+    {
+	key += '\0';
+	key += argv[ i ];
+    }
+    return key;
+}
+
+P4ResultCache::P4ResultCache( long l )
+{
+    entries = new P4ResultCacheEntries;
+    clock = 0;
+    bytes = 0;
+    limit = l;
+    hits = misses = stores = 0;
+}
+
+P4ResultCache::~P4ResultCache()
+{
+    Clear();
+    delete entries;
+}
+
+void
+P4ResultCache::SetLimit( long l )
+{
+    limit = l;
+    Evict( 0 );
+}
+
+void
+P4ResultCache::Clear()
+{
+    for( P4ResultCacheIter i = entries->begin(); i != entries->end(); ++i )
+	SvREFCNT_dec( (SV *) i->second.output );
+    entries->clear();
+    bytes = 0;
+}
+
+//
+// Discard the least recently used entries until there's room for want
+// more bytes.
+//
+void
+P4ResultCache::Evict( long want )
+{
+    while( !entries->empty() && bytes + want > limit )
+    {
+	P4ResultCacheIter oldest = entries->begin();
+	for( P4ResultCacheIter i = entries->begin(); i != entries->end(); ++i )
+	    if( i->second.used < oldest->second.used )
+		oldest = i;
+
+	bytes -= oldest->second.size;
+	SvREFCNT_dec( (SV *) oldest->second.output );
+	entries->erase( oldest );
+    }
+}
+
+//
+// Checks that a file argument names a revision that can't change.
+//
+static int
+ImmutableRev( const char *arg )
+{
+    if( strncmp( arg, "//", 2 ) )
+	return 0;
+
+    const char *rev = strpbrk( arg, "#@" );
+    if( !rev || strpbrk( rev + 1, "#@," ) )
+	return 0;
+
+    int wild = strstr( arg, "..." ) || strchr( arg, '*' ) || 
+	       strstr( arg, "%%" );
+
+    const char *n;
+    if( *rev == '#' && !wild )
+	n = rev + 1;
+    else if( rev[ 0 ] == '@' && rev[ 1 ] == '=' )
+	n = rev + 2;
+    else
+	return 0;
+
+    if( !*n || *n == '0' )
+	return 0;
+    for( ; *n; n++ )
+	if( !isdigit( (unsigned char) *n ) )
+	    return 0;
+    return 1;
+}
+
+static int
+IsNumber( const char *s )
+{
+    if( !*s ) 
+	return 0;
+    for( ; *s; s++ )
+	if( !isdigit( (unsigned char) *s ) )
+	    return 0;
+    return 1;
+}
+
+int
+P4ResultCache::Cacheable( const char *cmd, int argc, char * const *argv,
+			  int tagged )
+{
+    int		describe = !strcmp( cmd, "describe" );
+    int		fstat = !strcmp( cmd, "fstat" );
+    int		print = !strcmp( cmd, "print" );
+    int		files = 0;
+
+    if( !describe && !fstat && !print )
+	return 0;
+
+    // describe is only checked for a submitted change in tagged mode
+    if( describe && !tagged )
+	return 0;
+
+    for( int i = 0; i < argc; i++ )
+    {
+	const char *a = argv[ i ];
+
+	if( *a == '-' )
+	{
+	    if( describe && ( !strcmp( a, "-s" ) || !strcmp( a, "-f" ) || 
+			      !strncmp( a, "-d", 2 ) ) )
+		continue;
+	    if( fstat && !strncmp( a, "-O", 2 ) && strlen( a ) > 2 )
+		continue;
+	    if( print && ( !strcmp( a, "-q" ) || !strcmp( a, "-k" ) ) )
+		continue;
+
+	    // Flags that take a value
+	    if( ( ( describe || fstat ) && !strcmp( a, "-m" ) ) ||
+		( fstat && ( !strcmp( a, "-T" ) || !strcmp( a, "-F" ) ) ) )
+	    {
+		if( ++i >= argc )
+		    return 0;
+		if( !strcmp( a, "-m" ) && !IsNumber( argv[ i ] ) )
+		    return 0;
+		continue;
+	    }
+	    return 0;
+	}
+
+	if( describe ? !IsNumber( a ) : !ImmutableRev( a ) )
+	    return 0;
+	files++;
+    }
+
+    return files > 0;
+}
+
+//
+// Fields in fstat output that depend on a workspace, or that can be
+// changed after submission.
+//
+static const char *mutableFields[] = {
+    "action", "actionOwner", "change", "clientFile", "haveRev", 
+    "isMapped", "ourLock", "resolved", "unresolved", "reresolvable",
+    "workRev", "shelved", "movedRev", 0
+};
+
+static const char *mutablePrefixes[] = {
+    "other", "attr-", "openattr-", "resolve", 0
+};
+
+static int
+MutableRecord( HV *hv )
+{
+    HE *	he;
+    I32		klen;
+
+    hv_iterinit( hv );
+    while( ( he = hv_iternext( hv ) ) )
+    {
+	const char *key = hv_iterkey( he, &klen );
+
+	for( const char **f = mutableFields; *f; f++ )
+	    if( !strcmp( key, *f ) )
+		return 1;
+	for( const char **p = mutablePrefixes; *p; p++ )
+	    if( !strncmp( key, *p, strlen( *p ) ) )
+		return 1;
+    }
+    return 0;
+}
+
+int
+P4ResultCache::Storable( const char *cmd, AV *output )
+{
+    I32 last = av_len( output );
+
+    if( last < 0 )
+	return 0;
+
+    if( !strcmp( cmd, "print" ) )
+	return 1;
+
+    for( I32 i = 0; i <= last; i++ )
+    {
+	SV **svp = av_fetch( output, i, 0 );
+
+	if( !svp || !SvROK( *svp ) || SvTYPE( SvRV( *svp ) ) != SVt_PVHV )
+	    return 0;
+
+	HV *hv = (HV *) SvRV( *svp );
+
+	if( !strcmp( cmd, "describe" ) )
+	{
+	    SV **status = hv_fetch( hv, "status", 6, 0 );
+	    if( !status || strcmp( SvPV_nolen( *status ), "submitted" ) )
+		return 0;
+	}
+	else if( MutableRecord( hv ) )
+	    return 0;
+    }
+    return 1;
+}
+
+//
+// Deep copy of an output record, so that neither the caller nor the cache
+// can see changes the other makes. Blessed objects keep their class.
+//
+SV *
+P4ResultCache::Copy( SV *sv )
+{
+    if( !SvROK( sv ) )
+	return newSVsv( sv );
+
+    SV *	target = SvRV( sv );
+    SV *	copy;
+
+    if( SvTYPE( target ) == SVt_PVAV )
+    {
+	AV *	av = (AV *) target;
+	AV *	c = newAV();
+	I32	last = av_len( av );
+
+	av_extend( c, last );
+	for( I32 i = 0; i <= last; i++ )
+	{
+	    SV **svp = av_fetch( av, i, 0 );
+	    av_store( c, i, svp ? Copy( *svp ) : newSV( 0 ) );
+	}
+	copy = (SV *) c;
+    }
+    else if( SvTYPE( target ) == SVt_PVHV )
+    {
+	HV *	hv = (HV *) target;
+	HV *	c = newHV();
+	HE *	he;
+
+	hv_iterinit( hv );
+	while( ( he = hv_iternext( hv ) ) )
+	    hv_store_ent( c, hv_iterkeysv( he ), 
+			  Copy( hv_iterval( hv, he ) ), 0 );
+	copy = (SV *) c;
+    }
+    else
+	copy = newSVsv( target );
+
+    SV *rv = newRV_noinc( copy );
+    if( SvOBJECT( target ) )
+	sv_bless( rv, SvSTASH( target ) );
+    return rv;
+}
+
+int
+P4ResultCache::Fetch( const StrPtr &ident, const char *cmd, int argc,
+		      char * const *argv, P4Result &results )
+{
+    P4ResultCacheIter i = entries->find( CacheKey( ident, cmd, argc, argv ) );
+
+    if( i == entries->end() )
+    {
+	misses++;
+	return 0;
+    }
+
+    i->second.used = ++clock;
+    hits++;
+
+    AV *	av = i->second.output;
+    I32		last = av_len( av );
+
+    for( I32 n = 0; n <= last; n++ )
+    {
+	SV **svp = av_fetch( av, n, 0 );
+	if( svp ) results.AddOutput( Copy( *svp ) );
+    }
+    return 1;
+}
+
+void
+P4ResultCache::Store( const StrPtr &ident, const char *cmd, int argc,
+		      char * const *argv, AV *output )
+{
+    AV *	copy = newAV();
+    I32		last = av_len( output );
+
+    av_extend( copy, last );
+    for( I32 n = 0; n <= last; n++ )
+    {
+	SV **svp = av_fetch( output, n, 0 );
+	av_store( copy, n, svp ? Copy( *svp ) : newSV( 0 ) );
+    }
+
+    long size = P4RunMemory::Size( (SV *) copy );
+
+    // Don't let one huge result flush everything else out
+    if( size > limit / 2 )
+    {
+	SvREFCNT_dec( (SV *) copy );
+	return;
+    }
+
+    std::string	key = CacheKey( ident, cmd, argc, argv );
+    P4ResultCacheIter i = entries->find( key );
+
+    if( i != entries->end() )
+    {
+	bytes -= i->second.size;
+	SvREFCNT_dec( (SV *) i->second.output );
+	entries->erase( i );
+    }
+
+    Evict( size );
+
+    P4ResultCacheEntry &e = ( *entries )[ key ];
+    e.output = copy;
+    e.size = size;
+    e.used = ++clock;
+    bytes += size;
+    stores++;
+}
+
+HV *
+P4ResultCache::Stats()
+{
+    HV *	hv = newHV();
+
+    hv_store( hv, "Entries", 7, newSViv( entries->size() ), 0 );
+    hv_store( hv, "Bytes", 5, newSViv( bytes ), 0 );
+    hv_store( hv, "Limit", 5, newSViv( limit ), 0 );
+    hv_store( hv, "Hits", 4, newSViv( hits ), 0 );
+    hv_store( hv, "Misses", 6, newSViv( misses ), 0 );
+    hv_store( hv, "Stores", 6, newSViv( stores ), 0 );
+
+    return hv;
+}
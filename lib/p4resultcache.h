@@ -0,0 +1,79 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4resultcache.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: A size-bounded, in-memory cache of the results of
+ * 		  commands whose output can never change.
+ *
+ ******************************************************************************/
+
+class P4Result;
+struct P4ResultCacheEntries;
+
+class P4ResultCache
+{
+    public:
+			P4ResultCache( long limit );
+			~P4ResultCache();
+
+	void		SetLimit( long limit );
+	void		Clear();
+
+	// Returns true if this invocation of the command is one whose
+	// output can be cached. The output itself must still pass Storable()
+	static int	Cacheable( const char *cmd, int argc, 
+				   char * const *argv, int tagged );
+
+	// Returns true if the output shows that it's safe to keep
+	static int	Storable( const char *cmd, AV *output );
+
+	// The ident describes the connection: port, user and anything else
+	// that changes the form of the output.
+	int		Fetch( const StrPtr &ident, const char *cmd, int argc,
+			       char * const *argv, P4Result &results );
+	void		Store( const StrPtr &ident, const char *cmd, int argc,
+			       char * const *argv, AV *output );
+
+	HV *		Stats();
+
+    private:
+	static SV *	Copy( SV *sv );
+	void		Evict( long want );
+
+	P4ResultCacheEntries *	entries;
+	unsigned long	clock;
+	long		bytes;
+	long		limit;
+	long		hits;
+	long		misses;
+	long		stores;
+};
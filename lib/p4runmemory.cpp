@@ -0,0 +1,218 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4runmemory.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Approximate accounting of the Perl memory used to hold
+ * 		  the output of the most recent command.
+ *
+ * Sizes are estimated from the SV head and body structures plus the
+ * buffers and arrays they own, which is close to, but not exactly, what
+ * the allocator hands out. They're intended for spotting which queries
+ * are expensive, not for exact bookkeeping.
+ *
+ ******************************************************************************/
+#ifndef OS_NT
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4result.h"
+#include "p4runmemory.h"
+
+// Output records are shallow; anything deeper is probably a cycle.
+static const int maxDepth = 32;
+
+P4RunMemory::P4RunMemory()
+{
+    Start();
+}
+
+void
+P4RunMemory::Clear( Counts &c )
+{
+    c.svs = c.avs = c.hvs = c.bytes = 0;
+}
+
+void
+P4RunMemory::Start()
+{
+    Clear( allocated );
+    Clear( resident );
+    records = 0;
+    residentRecords = 0;
+    largest = 0;
+    peakRss = 0;
+}
+
+void
+P4RunMemory::AddRecord( SV *sv )
+{
+    Counts	c;
+
+    Clear( c );
+    Measure( sv, c );
+
+    allocated.svs += c.svs;
+    allocated.avs += c.avs;
+    allocated.hvs += c.hvs;
+    allocated.bytes += c.bytes;
+
+    records++;
+    if( c.bytes > largest )
+	largest = c.bytes;
+}
+
+//
+// Whatever is still held in the results once the command has finished
+// (i.e. wasn't consumed by an output handler) is resident, along with
+// the messages and track output.
+//
+void
+P4RunMemory::Finish( P4Result &results )
+{
+    AV * avs[] = { results.GetOutputInternal(), results.GetWarnings(),
+		   results.GetErrors(), results.GetMessages(), 
+		   results.GetTrack() };
+
+    Clear( resident );
+    residentRecords = 0;
+
+    for( size_t i = 0; i < sizeof( avs ) / sizeof( avs[ 0 ] ); i++ )
+    {
+	if( !avs[ i ] ) continue;
+	residentRecords += av_len( avs[ i ] ) + 1;
+	Measure( (SV *) avs[ i ], resident );
+    }
+
+    peakRss = PeakRSS();
+}
+
+void
+P4RunMemory::Measure( SV *sv, Counts &c, int depth )
+{
+    if( !sv || depth > maxDepth ) 
+	return;
+
+    c.bytes += sizeof( SV );
+
+    switch( SvTYPE( sv ) )
+    {
+    case SVt_PVAV:
+	{
+	    AV *av = (AV *) sv;
+	    c.avs++;
+	    c.bytes += sizeof( XPVAV ) + ( AvMAX( av ) + 1 ) * sizeof( SV * );
+	    for( I32 i = 0; i <= av_len( av ); i++ )
+	    {
+		SV **svp = av_fetch( av, i, 0 );
+		if( svp ) Measure( *svp, c, depth + 1 );
+	    }
+	}
+	break;
+
+    case SVt_PVHV:
+	{
+	    HV *	hv = (HV *) sv;
+	    HE *	he;
+	    I32		klen;
+
+	    c.hvs++;
+	    c.bytes += sizeof( XPVHV ) + ( HvMAX( hv ) + 1 ) * sizeof( HE * );
+
+	    hv_iterinit( hv );
+	    while( ( he = hv_iternext( hv ) ) )
+	    {
+		hv_iterkey( he, &klen );
+		c.bytes += sizeof( HE ) + sizeof( HEK ) + klen;
+		Measure( hv_iterval( hv, he ), c, depth + 1 );
+	    }
+	}
+	break;
+
+    default:
+	c.svs++;
+	if( SvROK( sv ) )
+	    Measure( SvRV( sv ), c, depth + 1 );
+	else if( SvPOK( sv ) )
+	    c.bytes += sizeof( XPV ) + SvLEN( sv );
+	else if( SvIOK( sv ) || SvNOK( sv ) )
+	    c.bytes += sizeof( XPVNV );
+	break;
+    }
+}
+
+long
+P4RunMemory::Size( SV *sv )
+{
+    Counts	c;
+
+    Clear( c );
+    Measure( sv, c );
+    return c.bytes;
+}
+
+long
+P4RunMemory::PeakRSS()
+{
+#ifdef OS_NT
+    return 0;
+#else
+    struct rusage ru;
+
+    if( getrusage( RUSAGE_SELF, &ru ) )
+	return 0;
+# ifdef __APPLE__
+    return ru.ru_maxrss / 1024;	// bytes on Darwin
+# else
+    return ru.ru_maxrss;		// KB elsewhere
+# endif
+#endif
+}
+
+HV *
+P4RunMemory::ToHash()
+{
+    HV *	hv = newHV();
+
+    hv_store( hv, "Records", 7, newSViv( records ), 0 );
+    hv_store( hv, "SVs", 3, newSViv( allocated.svs ), 0 );
+    hv_store( hv, "AVs", 3, newSViv( allocated.avs ), 0 );
+    hv_store( hv, "HVs", 3, newSViv( allocated.hvs ), 0 );
+    hv_store( hv, "Bytes", 5, newSViv( allocated.bytes ), 0 );
+    hv_store( hv, "LargestRecord", 13, newSViv( largest ), 0 );
+    hv_store( hv, "ResidentRecords", 15, newSViv( residentRecords ), 0 );
+    hv_store( hv, "ResidentBytes", 13, newSViv( resident.bytes ), 0 );
+    hv_store( hv, "PeakRSS", 7, newSViv( peakRss ), 0 );
+
+    return hv;
+}
@@ -0,0 +1,79 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4runmemory.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Approximate accounting of the Perl memory used to hold
+ * 		  the output of the most recent command.
+ *
+ ******************************************************************************/
+
+class P4Result;
+
+class P4RunMemory
+{
+    public:
+			P4RunMemory();
+
+	// Called at the start of each command, for each output record
+	// as it's created, and once the command has finished.
+	void		Start();
+	void		AddRecord( SV *sv );
+	void		Finish( P4Result &results );
+
+	// Returns a new hash describing the last command
+	HV *		ToHash();
+
+	// Peak resident set size of the process in KB, or 0 if unknown
+	static long	PeakRSS();
+
+	// Approximate bytes used by an SV and everything it refers to
+	static long	Size( SV *sv );
+
+    private:
+	struct Counts
+	{
+	    long	svs;
+	    long	avs;
+	    long	hvs;
+	    long	bytes;
+	};
+
+	static void	Measure( SV *sv, Counts &c, int depth = 0 );
+	static void	Clear( Counts &c );
+
+	Counts		allocated;
+	Counts		resident;
+	long		records;
+	long		residentRecords;
+	long		largest;
+	long		peakRss;
+};
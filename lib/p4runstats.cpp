@@ -0,0 +1,90 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4runstats.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Timing and volume statistics for the most recent command.
+ *
+ ******************************************************************************/
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4perltimer.h"
+#include "p4runstats.h"
+
+P4RunStats::P4RunStats()
+{
+    Start( "" );
+}
+
+void
+P4RunStats::Start( const char *cmd )
+{
+    command.Set( cmd );
+    started = P4PerlTimer::Now();
+    wall = 0;
+    convert = 0;
+    spec = 0;
+    callback = 0;
+    records = 0;
+    messages = 0;
+    bytes = 0;
+}
+
+void
+P4RunStats::Stop()
+{
+    wall = P4PerlTimer::Now() - started;
+}
+
+//
+// Whatever time wasn't spent in P4Perl itself was spent waiting on the
+// network and the server (and in the API's own processing).
+//
+HV *
+P4RunStats::ToHash()
+{
+    HV *	hv = newHV();
+    double	wait = wall - convert - spec - callback;
+
+    if( wait < 0 ) wait = 0;
+
+    hv_store( hv, "Command", 7, newSVpv( command.Text(), command.Length() ), 0 );
+    hv_store( hv, "Wall", 4, newSVnv( wall ), 0 );
+    hv_store( hv, "ServerWait", 10, newSVnv( wait ), 0 );
+    hv_store( hv, "Conversion", 10, newSVnv( convert ), 0 );
+    hv_store( hv, "Spec", 4, newSVnv( spec ), 0 );
+    hv_store( hv, "Callback", 8, newSVnv( callback ), 0 );
+    hv_store( hv, "Records", 7, newSViv( records ), 0 );
+    hv_store( hv, "Messages", 8, newSViv( messages ), 0 );
+    hv_store( hv, "Bytes", 5, newSViv( bytes ), 0 );
+
+    return hv;
+}
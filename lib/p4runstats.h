@@ -0,0 +1,61 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4runstats.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Timing and volume statistics for the most recent command,
+ * 		  collected on request by PerlClientApi and PerlClientUser.
+ *
+ ******************************************************************************/
+
+class P4RunStats
+{
+    public:
+			P4RunStats();
+
+	// Called at the start and end of each command
+	void		Start( const char *cmd );
+	void		Stop();
+
+	// Returns a new hash describing the last command
+	HV *		ToHash();
+
+    public:
+	StrBuf		command;
+	double		started;
+	double		wall;
+	double		convert;	// StrDict -> hash, text -> SV
+	double		spec;		// Spec parsing and P4::Spec creation
+	double		callback;	// Perl output handler calls
+	long		records;
+	long		messages;
+	long		bytes;
+};
@@ -41,6 +41,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "perlheaders.h"
 #include "p4perldebug.h"
 #include "p4specdata.h"
+#include "p4utf8.h"
 
 //
 // We're expecting a blessed hashref, but we only need to store the 
@@ -48,6 +49,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 SpecDataPerl::SpecDataPerl( SV * h )
 {
+    utf8Mode = 0;
     if( !SvROK( h ) || SvTYPE( SvRV( h ) ) != SVt_PVHV )
     {
 	warn( "Not a P4::Spec object. Ignoring..." );
@@ -59,6 +61,7 @@ SpecDataPerl::SpecDataPerl( SV * h )
 
 SpecDataPerl::SpecDataPerl( HV * h )
 {
+    utf8Mode = 0;
     hash = h;
 }
     
@@ -130,6 +133,7 @@ SpecDataPerl::SetLine( SpecElem *sd, int x, const StrPtr *v, Error *e )
 
 	key = newSVpv( sd->tag.Text(), sd->tag.Length() );
 	val = newSVpv( v->Text(), v->Length() );
+	P4Utf8::Mark( val, utf8Mode );
 
 	if( sd->IsList() )
 	{
@@ -46,8 +46,12 @@ class SpecDataPerl : public SpecData
 	virtual void	SetLine( SpecElem *sd, int x, const StrPtr *val,
 				Error *e );
 
+	// Flag values as UTF-8; see P4Utf8::Mode
+	void		SetUtf8Mode( int m ) { utf8Mode = m; }
+
     private:
 	HV *	hash;
 	StrBuf	last;
+	int	utf8Mode;
 };
 
@@ -0,0 +1,412 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4synciopolicy.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: How sync writes files.
+ *
+ * The files handed out wrap the API's own FileSys, so translation,
+ * compression and permissions are untouched. What the policy changes:
+ *
+ *	buffer	 the size of the write buffer, so a file goes out in fewer,
+ *		 larger writes.
+ *	presize	 if the server says how big the file is, size the buffer
+ *		 to fit (up to 'buffer', or 4MB) so it's written in one go.
+ *		 The API truncates files as it opens them, so space can't
+ *		 usefully be reserved on disk ahead of time; this is the
+ *		 nearest we can get.
+ *	fsync	 fsync files, and the directories they were renamed in, in
+ *		 groups of this many on a background thread, rather than
+ *		 one at a time as they're closed. The API's own fsync calls
+ *		 become no-ops. The command doesn't return until every file
+ *		 has been synced, and warns if any couldn't be. On Windows
+ *		 each file is fsynced as it's closed instead.
+ *
+ * The wrapper copies the path across before each call as the API sets it
+ * directly in places (temporary names, for instance).
+ *
+ ******************************************************************************/
+#include <string>
+#include <vector>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <string.h>
+#ifndef OS_NT
+# include <fcntl.h>
+# include <unistd.h>
+# include <errno.h>
+#endif
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4synciopolicy.h"
+
+struct P4SyncIOPending
+{
+	std::mutex			lock;
+	std::vector<std::string>	files;
+	std::set<std::string>		dirs;
+	std::thread			worker;
+
+	// Failures, kept apart from 'lock' as a group may run while
+	// Launch() holds that
+	std::mutex			errorLock;
+	int				failures;
+	std::string			failed;
+
+	P4SyncIOPending() { failures = 0; }
+};
+
+/*******************************************************************************
+ * P4SyncFile - FileSys wrapper applying the policy
+ ******************************************************************************/
+
+class P4SyncFile : public FileSys
+{
+    public:
+	P4SyncFile( P4SyncIOPolicy *p, FileSysType t, int buffer )
+	{
+	    policy = p;
+	    file = FileSys::Create( t );
+	    type = t;
+	    writing = 0;
+	    written = 0;
+	    if( buffer > 0 )
+		file->SetBufferSize( buffer );
+	}
+
+	~P4SyncFile()
+	{
+	    // Written in place rather than renamed there
+	    if( written )
+		policy->Written( path );
+	    delete file;
+	}
+
+	FileSys *Inner()
+	{
+	    Copy();
+	    return file;
+	}
+
+	void Set( const StrPtr &name )
+	{
+	    FileSys::Set( name );
+	    file->Set( name );
+	}
+
+	void Set( const StrPtr &name, Error *e )
+	{
+	    FileSys::Set( name, e );
+	    file->Set( name, e );
+	}
+
+	void Open( FileOpenMode mode, Error *e )
+	{
+	    Copy();
+	    file->Open( mode, e );
+	    writing = mode != FOM_READ;
+	    written = 0;
+	}
+
+	void Write( const char *buf, int len, Error *e )
+	{
+	    file->Write( buf, len, e );
+	}
+
+	int Read( char *buf, int len, Error *e )
+	{
+	    return file->Read( buf, len, e );
+	}
+
+	void Close( Error *e )
+	{
+	    if( writing && policy->FsyncsOnClose() )
+		file->Fsync( e );
+	    file->Close( e );
+	    written = writing && !e->Test();
+	}
+
+	void Rename( FileSys *target, Error *e )
+	{
+	    P4SyncFile *t = dynamic_cast<P4SyncFile *>( target );
+	    Copy();
+	    file->Rename( t ? t->Inner() : target, e );
+	    if( !e->Test() && written )
+	    {
+		policy->Written( *target->Path() );
+		written = 0;
+	    }
+	}
+
+	void Unlink( Error *e = 0 )
+	{
+	    Copy();
+	    file->Unlink( e );
+	    written = 0;
+	}
+
+	void Fsync( Error *e )
+	{
+	    if( !policy->DefersFsync() )
+		file->Fsync( e );
+	}
+
+	int Stat()			{ Copy(); return file->Stat(); }
+	int StatModTime()		{ Copy(); return file->StatModTime(); }
+	void Truncate( Error *e )	{ Copy(); file->Truncate( e ); }
+	void Truncate( offL_t o, Error *e ) { Copy(); file->Truncate( o, e ); }
+	void Chmod( FilePerm p, Error *e ) { Copy(); file->Chmod( p, e ); }
+	void ChmodTime( Error *e )	{ Copy(); file->ChmodTime( e ); }
+	void SetAttribute( FileSysType a, Error *e ) 
+					{ Copy(); file->SetAttribute( a, e ); }
+	offL_t GetSize()		{ Copy(); return file->GetSize(); }
+	void Seek( offL_t o, Error *e )	{ file->Seek( o, e ); }
+	offL_t Tell()			{ return file->Tell(); }
+	void Perms( FilePerm p )	{ FileSys::Perms( p ); file->Perms( p ); }
+	void ModTime( StrPtr *u )	{ file->ModTime( u ); }
+	void ModTime( int t )		{ FileSys::ModTime( t ); file->ModTime( t ); }
+	int GetModTime()		{ return file->GetModTime(); }
+	void SetDigest( MD5 *m )	{ file->SetDigest( m ); }
+	void Digest( StrBuf *d, Error *e ) { Copy(); file->Digest( d, e ); }
+	void SetContentCharSetPriv( int x ) { file->SetContentCharSetPriv( x ); }
+	int GetContentCharSetPriv()	{ return file->GetContentCharSetPriv(); }
+	void Translator( CharSetCvt *c ) { file->Translator( c ); }
+	void MkDir( const StrPtr &p, Error *e ) { file->MkDir( p, e ); }
+	void MkDir( Error *e )		{ Copy(); file->MkDir( e ); }
+	void RmDir( const StrPtr &p, Error *e ) { file->RmDir( p, e ); }
+	void PurgeDir( const char *p, Error *e ) { file->PurgeDir( p, e ); }
+	FileSysType CheckType( int scan ) { Copy(); return file->CheckType( scan ); }
+	int LinkCount()			{ Copy(); return file->LinkCount(); }
+	void SetBufferSize( size_t s )	{ file->SetBufferSize( s ); }
+	int BufferSize()		{ return file->BufferSize(); }
+	int IsDeleteOnClose()		{ return file->IsDeleteOnClose(); }
+	void SetDeleteOnClose()		{ file->SetDeleteOnClose(); }
+	void ClearDeleteOnClose()	{ file->ClearDeleteOnClose(); }
+	void Cleanup()			{ file->Cleanup(); }
+
+    private:
+	void Copy()
+	{
+	    if( *file->Path() != path )
+		file->Set( path );
+	}
+
+	P4SyncIOPolicy *	policy;
+	FileSys *		file;
+	int			writing;
+	int			written;
+};
+
+/*******************************************************************************
+ * P4SyncIOPolicy
+ ******************************************************************************/
+
+P4SyncIOPolicy::P4SyncIOPolicy()
+{
+	bufferSize = 0;
+	presize = 0;
+	fsyncGroup = 0;
+	pending = new P4SyncIOPending;
+}
+
+P4SyncIOPolicy::~P4SyncIOPolicy()
+{
+	Finish();
+	delete pending;
+}
+
+static int
+OptionValue( HV * hv, const char *key )
+{
+	SV ** v = hv_fetch( hv, key, strlen( key ), 0 );
+	if( !v || !SvOK( *v ) )
+	    return 0;
+	IV n = SvIV( *v );
+	return n > 0 ? (int)n : 0;
+}
+
+void
+P4SyncIOPolicy::Configure( HV * options )
+{
+	bufferSize = OptionValue( options, "buffer" );
+	presize = OptionValue( options, "presize" );
+	fsyncGroup = OptionValue( options, "fsync" );
+}
+
+HV *
+P4SyncIOPolicy::GetOptions()
+{
+	HV * hv = newHV();
+	hv_store( hv, "buffer", 6, newSViv( bufferSize ), 0 );
+	hv_store( hv, "presize", 7, newSViv( presize ), 0 );
+	hv_store( hv, "fsync", 5, newSViv( fsyncGroup ), 0 );
+	return hv;
+}
+
+int
+P4SyncIOPolicy::Applies( const StrPtr &cmd )
+{
+	return cmd == "sync" || cmd == "update";
+}
+
+FileSys *
+P4SyncIOPolicy::File( FileSysType type, StrDict * vars )
+{
+	int buffer = bufferSize;
+
+	if( presize && vars )
+	{
+	    StrPtr * s = vars->GetVar( P4Tag::v_fileSize );
+	    P4INT64 size = s ? s->Atoi64() : 0;
+	    int limit = bufferSize > 0 ? bufferSize : 4 * 1024 * 1024;
+
+	    // Small files fit entirely; anything bigger gets the largest
+	    if( size > 0 )
+		buffer = size < limit ? (int)size : limit;
+	}
+
+	return new P4SyncFile( this, type, buffer );
+}
+
+void
+P4SyncIOPolicy::Written( const StrPtr &path )
+{
+	if( !DefersFsync() )
+	    return;
+
+	std::string p( path.Text(), path.Length() );
+	size_t slash = p.find_last_of( "/\\" );
+
+	int launch;
+	{
+	    std::lock_guard<std::mutex> g( pending->lock );
+	    pending->files.push_back( p );
+	    if( slash != std::string::npos )
+		pending->dirs.insert( p.substr( 0, slash ? slash : 1 ) );
+	    launch = (int)pending->files.size() >= fsyncGroup;
+	}
+
+	if( launch )
+	    Launch();
+}
+
+#ifndef OS_NT
+//
+// fsync one file or directory. A file that's gone since it was written
+// has nothing left to sync, and some filesystems can't fsync directories
+// (EINVAL); neither counts as a failure. Runs on the background thread,
+// so failures are only recorded here and reported by Finish().
+//
+static void
+FsyncPath( P4SyncIOPending *p, const std::string &path, int dir )
+{
+	int fd = open( path.c_str(), O_RDONLY );
+	int ok = fd >= 0 ? !fsync( fd ) : errno == ENOENT;
+
+	if( !ok && dir && errno == EINVAL )
+	    ok = 1;
+	if( fd >= 0 )
+	    close( fd );
+	if( ok )
+	    return;
+
+	std::lock_guard<std::mutex> g( p->errorLock );
+	if( !p->failures++ )
+	    p->failed = path;
+}
+#endif
+
+static void
+FsyncGroup( P4SyncIOPending *p, std::vector<std::string> files, 
+		std::set<std::string> dirs )
+{
+#ifndef OS_NT
+	for( size_t i = 0; i < files.size(); i++ )
+	    FsyncPath( p, files[ i ], 0 );
+
+	for( std::set<std::string>::iterator d = dirs.begin(); 
+		d != dirs.end(); ++d )
+	    FsyncPath( p, *d, 1 );
+#endif
+}
+
+/*
+ * Hand the files written so far to a background thread. Only one group is
+ * in flight at a time: the next waits for it, which keeps sync from
+ * running too far ahead of the disk.
+ */
+void
+P4SyncIOPolicy::Launch()
+{
+	std::lock_guard<std::mutex> g( pending->lock );
+
+	if( pending->worker.joinable() )
+	    pending->worker.join();
+
+	if( pending->files.empty() )
+	    return;
+
+	std::vector<std::string> files;
+	std::set<std::string> dirs;
+	files.swap( pending->files );
+	dirs.swap( pending->dirs );
+
+	try
+	{
+	    pending->worker = std::thread( FsyncGroup, pending, files, dirs );
+	}
+	catch( ... )
+	{
+	    FsyncGroup( pending, files, dirs );
+	}
+}
+
+void
+P4SyncIOPolicy::Finish()
+{
+	Launch();
+
+	{
+	    std::lock_guard<std::mutex> g( pending->lock );
+	    if( pending->worker.joinable() )
+		pending->worker.join();
+	}
+
+	// Back on the main thread, so now it's safe to tell Perl
+	if( pending->failures )
+	{
+	    warn( "Sync IO policy: %d file(s) could not be synced to disk, "
+		  "including %s", pending->failures, pending->failed.c_str() );
+	    pending->failures = 0;
+	    pending->failed.clear();
+	}
+}
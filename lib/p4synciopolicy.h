@@ -0,0 +1,83 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4synciopolicy.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: How sync writes files: write buffer size, buffers sized
+ * 		  from the file size, and fsync deferred and done in groups.
+ *
+ ******************************************************************************/
+
+struct P4SyncIOPending;
+
+class P4SyncIOPolicy
+{
+    public:
+			P4SyncIOPolicy();
+			~P4SyncIOPolicy();
+
+	// Reads 'buffer', 'presize' and 'fsync' from the hash
+	void		Configure( HV * options );
+	HV *		GetOptions();
+
+	// Whether the policy applies to a command's workspace files
+	static int	Applies( const StrPtr &cmd );
+
+	// 'vars' is the current server message, if known, from which the
+	// size of the file about to be written may be taken.
+	FileSys *	File( FileSysType type, StrDict * vars );
+
+	// A file has been written to its final path. Thread safe.
+	void		Written( const StrPtr &path );
+
+	// Whether fsyncs are grouped on a background thread. Not on
+	// Windows, where each file is fsynced as it's closed instead.
+#ifdef OS_NT
+	int		DefersFsync() { return 0; }
+	int		FsyncsOnClose() { return fsyncGroup > 0; }
+#else
+	int		DefersFsync() { return fsyncGroup > 0; }
+	int		FsyncsOnClose() { return 0; }
+#endif
+
+	// Wait for any outstanding fsyncs, warning if any failed. Called
+	// at the end of a command.
+	void		Finish();
+
+    private:
+	void		Launch();
+
+	int		bufferSize;
+	int		presize;
+	int		fsyncGroup;
+
+	P4SyncIOPending *	pending;
+};
@@ -0,0 +1,292 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4trackstats.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Parses the performance tracking data sent by the server
+ * 		  when track mode is enabled into a hash.
+ *
+ * Track output looks like this:
+ *
+ *	--- lapse .044s
+ *	--- usage 10+11us 0+0io 0+0net 4012k 0pf
+ *	--- rpc msgs/size in+out 2+3/0mb+0mb himarks 318788/318788 snd/rcv .000s/.001s
+ *	--- db.counters
+ *	---   pages in+out+cached 6+0+2
+ *	---   locks read/write 1/0 rows get+pos+scan put+del 2+0+0 0+0
+ *	---   total lock wait+held read/write 0ms+0ms/0ms+0ms
+ *	---   max lock wait+held read/write 0ms+0ms/0ms+0ms
+ *	---   peek count 1 wait+held total/max 0ms+0ms/0ms+0ms
+ *
+ * Each line is matched on its leading words and the numbers are then
+ * read off in order. Sizes are converted to bytes; times are left in the
+ * units the server uses (seconds for lapse and rpc, milliseconds for
+ * locks). Lines we don't recognise are ignored.
+ *
+ ******************************************************************************/
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4trackstats.h"
+
+static const int maxNumbers = 16;
+
+P4TrackStats::P4TrackStats()
+{
+    data = 0;
+    table = 0;
+    Reset();
+}
+
+P4TrackStats::~P4TrackStats()
+{
+    SvREFCNT_dec( (SV *) data );
+}
+
+//
+// Start a new hash rather than clearing the old one, so that any reference
+// the caller kept to the previous command's data is left intact.
+//
+void
+P4TrackStats::Reset()
+{
+    if( data )
+	SvREFCNT_dec( (SV *) data );
+    data = newHV();
+    table = 0;
+}
+
+SV *
+P4TrackStats::ToHash()
+{
+    return newRV_inc( (SV *) data );
+}
+
+//
+// Reads the numbers in [p,end) into vals, returning how many were found.
+// A number must start a token (i.e. follow a space, '+' or '/') so that
+// digits inside words are skipped, and may carry a unit suffix. Size
+// units are scaled to bytes; anything else is left alone.
+//
+int
+P4TrackStats::Numbers( const char *p, const char *end, double *vals, int max )
+{
+    int		n = 0;
+    char	prev = ' ';
+
+    while( p < end && n < max )
+    {
+	int digit = isdigit( (unsigned char) *p ) ||
+		    ( *p == '.' && p + 1 < end && 
+		      isdigit( (unsigned char) p[ 1 ] ) );
+
+	if( !digit || ( prev != ' ' && prev != '+' && prev != '/' ) )
+	{
+	    prev = *p++;
+	    continue;
+	}
+
+	char *	e;
+	double	v = strtod( p, &e );
+
+	if( e > end ) e = (char *) end;
+	p = e;
+
+	switch( p < end ? *p : 0 )
+	{
+	case 'k': v *= 1024.0; break;
+	case 'm': if( p + 1 < end && p[ 1 ] == 'b' ) v *= 1024.0 * 1024; break;
+	case 'g': v *= 1024.0 * 1024 * 1024; break;
+	case 't': v *= 1024.0 * 1024 * 1024 * 1024; break;
+	}
+
+	while( p < end && isalpha( (unsigned char) *p ) )
+	    p++;
+
+	vals[ n++ ] = v;
+	prev = 'x';
+    }
+
+    return n;
+}
+
+void
+P4TrackStats::Store( HV *hv, const char *key, double val, StoreMode mode )
+{
+    I32		klen = strlen( key );
+    SV **	svp;
+
+    if( mode != SET && ( svp = hv_fetch( hv, key, klen, 0 ) ) )
+    {
+	double old = SvNV( *svp );
+	if( mode == ADD )
+	    val += old;
+	else if( old > val )
+	    val = old;
+    }
+
+    // Whole numbers are stored as integers so they compare and print
+    // naturally on the Perl side.
+    SV *sv = ( val == (double)(IV) val ) ? newSViv( (IV) val ) : newSVnv( val );
+    hv_store( hv, key, klen, sv, 0 );
+}
+
+HV *
+P4TrackStats::SubHash( HV *hv, const char *key, int klen )
+{
+    SV **svp = hv_fetch( hv, key, klen, 0 );
+
+    if( svp && SvROK( *svp ) )
+	return (HV *) SvRV( *svp );
+
+    HV *sub = newHV();
+    hv_store( hv, key, klen, newRV_noinc( (SV *) sub ), 0 );
+    return sub;
+}
+
+#define PREFIX( s ) \
+    ( len >= (int) sizeof( s ) - 1 && !strncmp( line, s, sizeof( s ) - 1 ) )
+
+void
+P4TrackStats::Parse( const char *line, int len )
+{
+    const char *	end = line + len;
+    double		v[ maxNumbers ];
+    int			n;
+
+    if( len > 2 && line[ 0 ] == ' ' && line[ 1 ] == ' ' )
+    {
+	// Detail for the table named on a previous line
+
+	if( !table )
+	    return;
+
+	line += 2;
+	len -= 2;
+
+	n = Numbers( line, end, v, maxNumbers );
+
+	if( PREFIX( "pages in+out+cached" ) && n >= 3 )
+	{
+	    Store( table, "PagesIn", v[ 0 ], ADD );
+	    Store( table, "PagesOut", v[ 1 ], ADD );
+	    Store( table, "PagesCached", v[ 2 ], ADD );
+	}
+	else if( PREFIX( "locks read/write" ) && n >= 7 )
+	{
+	    Store( table, "ReadLocks", v[ 0 ], ADD );
+	    Store( table, "WriteLocks", v[ 1 ], ADD );
+	    Store( table, "RowsGet", v[ 2 ], ADD );
+	    Store( table, "RowsPos", v[ 3 ], ADD );
+	    Store( table, "RowsScan", v[ 4 ], ADD );
+	    Store( table, "RowsPut", v[ 5 ], ADD );
+	    Store( table, "RowsDel", v[ 6 ], ADD );
+	}
+	else if( PREFIX( "total lock wait+held" ) && n >= 4 )
+	{
+	    Store( table, "ReadWait", v[ 0 ], ADD );
+	    Store( table, "ReadHeld", v[ 1 ], ADD );
+	    Store( table, "WriteWait", v[ 2 ], ADD );
+	    Store( table, "WriteHeld", v[ 3 ], ADD );
+	}
+	else if( PREFIX( "max lock wait+held" ) && n >= 4 )
+	{
+	    Store( table, "MaxReadWait", v[ 0 ], MAX );
+	    Store( table, "MaxReadHeld", v[ 1 ], MAX );
+	    Store( table, "MaxWriteWait", v[ 2 ], MAX );
+	    Store( table, "MaxWriteHeld", v[ 3 ], MAX );
+	}
+	else if( PREFIX( "peek count" ) && n >= 3 )
+	{
+	    Store( table, "PeekCount", v[ 0 ], ADD );
+	    Store( table, "PeekWait", v[ 1 ], ADD );
+	    Store( table, "PeekHeld", v[ 2 ], ADD );
+	}
+	return;
+    }
+
+    table = 0;
+
+    if( PREFIX( "lapse " ) )
+    {
+	if( Numbers( line, end, v, 1 ) )
+	    Store( data, "Lapse", v[ 0 ], ADD );
+    }
+    else if( PREFIX( "usage " ) )
+    {
+	HV *usage = SubHash( data, "Usage", 5 );
+
+	if( ( n = Numbers( line, end, v, maxNumbers ) ) >= 6 )
+	{
+	    Store( usage, "UserTime", v[ 0 ], ADD );
+	    Store( usage, "SystemTime", v[ 1 ], ADD );
+	    Store( usage, "IoIn", v[ 2 ], ADD );
+	    Store( usage, "IoOut", v[ 3 ], ADD );
+	    Store( usage, "NetIn", v[ 4 ], ADD );
+	    Store( usage, "NetOut", v[ 5 ], ADD );
+	}
+	if( n >= 8 )
+	{
+	    Store( usage, "MaxRss", v[ 6 ], MAX );
+	    Store( usage, "PageFaults", v[ 7 ], ADD );
+	}
+    }
+    else if( PREFIX( "rpc msgs/size in+out " ) )
+    {
+	HV *rpc = SubHash( data, "Rpc", 3 );
+
+	if( ( n = Numbers( line, end, v, maxNumbers ) ) >= 4 )
+	{
+	    Store( rpc, "MsgsIn", v[ 0 ], ADD );
+	    Store( rpc, "MsgsOut", v[ 1 ], ADD );
+	    Store( rpc, "BytesIn", v[ 2 ], ADD );
+	    Store( rpc, "BytesOut", v[ 3 ], ADD );
+	}
+	if( n >= 6 )
+	{
+	    Store( rpc, "HimarkFwd", v[ 4 ], MAX );
+	    Store( rpc, "HimarkRev", v[ 5 ], MAX );
+	}
+	if( n >= 8 )
+	{
+	    Store( rpc, "SendTime", v[ 6 ], ADD );
+	    Store( rpc, "RecvTime", v[ 7 ], ADD );
+	}
+    }
+    else if( len && !memchr( line, ' ', len ) && memchr( line, '.', len ) )
+    {
+	// A table name, e.g. "db.have" or "rdb.lbr"
+	HV *tables = SubHash( data, "Tables", 6 );
+	table = SubHash( tables, line, len );
+    }
+}
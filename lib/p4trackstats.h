@@ -0,0 +1,65 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4trackstats.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Parses the performance tracking data sent by the server
+ * 		  when track mode is enabled into a hash.
+ *
+ ******************************************************************************/
+
+class P4TrackStats
+{
+    public:
+			P4TrackStats();
+			~P4TrackStats();
+
+	// Discards the data from the previous command
+	void		Reset();
+
+	// Parses one line of track output, without the leading "--- "
+	void		Parse( const char *line, int len );
+
+	// Returns a new reference to the parsed data
+	SV *		ToHash();
+
+    private:
+	enum StoreMode { SET, ADD, MAX };
+
+	static int	Numbers( const char *p, const char *end,
+				 double *vals, int max );
+	static void	Store( HV *hv, const char *key, double val,
+			       StoreMode mode = SET );
+	static HV *	SubHash( HV *hv, const char *key, int klen );
+
+	HV *		data;
+	HV *		table;
+};
@@ -0,0 +1,84 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4utf8.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: Creation of Perl strings from server output that is known
+ * 		  to be UTF-8, so that they carry Perl's UTF8 flag.
+ *
+ * Pure ASCII strings are left unflagged as they mean the same thing either
+ * way, and unflagged strings are cheaper for Perl to work with. Most
+ * output is ASCII, so that check is done a word at a time.
+ *
+ ******************************************************************************/
+#include <string.h>
+#include <clientapi.h>
+#include "perlheaders.h"
+#include "p4utf8.h"
+
+int
+P4Utf8::IsAscii( const char *s, STRLEN len )
+{
+    const unsigned long	high = ~0UL / 0xff * 0x80;
+    unsigned long	w;
+
+    for( ; len >= sizeof( w ); s += sizeof( w ), len -= sizeof( w ) )
+    {
+	memcpy( &w, s, sizeof( w ) );
+	if( w & high )
+	    return 0;
+    }
+
+    for( ; len; s++, len-- )
+	if( *(const unsigned char *) s & 0x80 )
+	    return 0;
+
+    return 1;
+}
+
+void
+P4Utf8::Mark( SV *sv, int mode )
+{
+    STRLEN	len;
+    const char *s;
+
+    if( mode == BYTES || !SvPOK( sv ) || SvUTF8( sv ) )
+	return;
+
+    s = SvPV( sv, len );
+    if( IsAscii( s, len ) )
+	return;
+
+    if( mode == VALIDATE && !is_utf8_string( (U8 *) s, len ) )
+	return;
+
+    SvUTF8_on( sv );
+}
@@ -0,0 +1,639 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4virtualworkspace.cpp
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: A workspace that lives outside the filesystem.
+ *
+ * PerlClientUser::File() hands out P4VirtualFile objects in place of real
+ * files while a virtual workspace is set and a sync is running. The client
+ * writes each file to a temporary name and renames it into place, so
+ * content is held in memory until the rename (or the end of the command,
+ * for anything written in place) and only then delivered, under its final
+ * path:
+ *
+ *	code ref	called as $code->( $path, $content, \%details ), or
+ *			$code->( $path, undef ) when the file is deleted
+ *	hash ref	$hash->{ $path } = \%details, with the content
+ *			under 'content'; deleted files are removed
+ *	filehandle	a ustar entry is written, named by the path with any
+ *			leading '/' or drive removed. Deletes are ignored.
+ *			The end of the archive is written when the virtual
+ *			workspace is cleared.
+ *
+ * The details are the file's 'type' (text, binary, symlink, unicode,
+ * utf16, with '+x' if executable), the MD5 'digest' of the content as
+ * delivered and its 'size'. Text arrives with the server's LF line endings
+ * and no charset translation, so the digests match those 'fstat -Ol'
+ * reports. Files the server sends compressed are expanded through a
+ * temporary file, as only the API knows the compression format.
+ *
+ * Callbacks run on the calling thread, in the middle of the sync; they
+ * must not run commands on the same P4 object.
+ *
+ ******************************************************************************/
+#include <string>
+#include <map>
+#include <string.h>
+#include <ctype.h>
+#include <clientapi.h>
+#include <md5.h>
+#include "perlheaders.h"
+#include "p4virtualworkspace.h"
+
+struct P4VirtualFileData
+{
+	StrBuf		data;
+	FileSysType	type;
+	int		modTime;
+};
+
+struct P4VirtualStaged : public std::map< std::string, P4VirtualFileData >
+{
+};
+
+/*******************************************************************************
+ * P4VirtualFile - a FileSys whose content is held in memory
+ ******************************************************************************/
+
+class P4VirtualFile : public FileSys
+{
+    public:
+	P4VirtualFile( P4VirtualWorkspace *w, FileSysType t )
+	{
+	    ws = w;
+	    type = t;
+	    perms = FPM_RW;
+	    modTime = 0;
+	    mode = -1;
+	    offset = 0;
+	    inflate = 0;
+	}
+
+	~P4VirtualFile()
+	{
+	    if( inflate )
+	    {
+		inflate->Unlink();
+		delete inflate;
+	    }
+	}
+
+	void Open( FileOpenMode m, Error *e )
+	{
+	    mode = m;
+	    offset = 0;
+	    data.Clear();
+
+	    if( m == FOM_READ )
+	    {
+		if( !ws->Lookup( path, data ) )
+		{
+		    e->Set( E_FAILED, "%file% is not in the virtual workspace." );
+		    *e << path;
+		    mode = -1;
+		}
+		return;
+	    }
+
+	    // Compressed content is expanded by the API's own file class.
+	    if( ( type & FST_MASK ) == FST_GUNZIP )
+	    {
+		inflate = FileSys::CreateGlobalTemp( type );
+		inflate->Open( FOM_WRITE, e );
+	    }
+	}
+
+	void Write( const char *buf, int len, Error *e )
+	{
+	    if( inflate )
+		inflate->Write( buf, len, e );
+	    else
+		data.Append( buf, len );
+	}
+
+	int Read( char *buf, int len, Error *e )
+	{
+	    int n = data.Length() - offset;
+	    if( n > len )
+		n = len;
+	    if( n <= 0 )
+		return 0;
+	    memcpy( buf, data.Text() + offset, n );
+	    offset += n;
+	    return n;
+	}
+
+	void Close( Error *e )
+	{
+	    if( mode != FOM_READ && mode != -1 )
+	    {
+		if( inflate )
+		    Expand( e );
+		if( !e->Test() )
+		    ws->Stage( path, data, type, modTime );
+	    }
+	    mode = -1;
+	    data.Clear();
+	}
+
+	int Stat()
+	{
+	    return ws->Exists( path ) ? FSF_EXISTS : 0;
+	}
+
+	int StatModTime()			{ return modTime; }
+	void Truncate( Error *e )		{ data.Clear(); }
+	void Truncate( offL_t o, Error *e )
+	{
+	    if( o < data.Length() )
+		data.SetLength( (int)o );
+	}
+	void Unlink( Error *e = 0 )		{ ws->Remove( path ); }
+	void Chmod( FilePerm p, Error *e )	{ perms = p; }
+	void ChmodTime( Error *e )		{}
+	void MkDir( const StrPtr &p, Error *e )	{}
+	void MkDir( Error *e )			{}
+	void RmDir( const StrPtr &p, Error *e )	{}
+	void PurgeDir( const char *p, Error *e ) {}
+
+	void Rename( FileSys *target, Error *e )
+	{
+	    if( !ws->Rename( path, *target->Path() ) )
+	    {
+		e->Set( E_FAILED, "%file% is not in the virtual workspace." );
+		*e << path;
+	    }
+	}
+
+	offL_t GetSize()
+	{
+	    StrBuf d;
+	    if( mode != -1 )
+		return data.Length();
+	    return ws->Lookup( path, d ) ? d.Length() : 0;
+	}
+
+	void Seek( offL_t o, Error * )		{ offset = (int)o; }
+	offL_t Tell()				{ return offset; }
+
+	void Digest( StrBuf *digest, Error *e )
+	{
+	    StrBuf d;
+	    MD5 md5;
+
+	    if( !ws->Lookup( path, d ) )
+	    {
+		e->Set( E_FAILED, "%file% is not in the virtual workspace." );
+		*e << path;
+		return;
+	    }
+	    md5.Update( d );
+	    md5.Final( *digest );
+	}
+
+    private:
+	void Expand( Error *e )
+	{
+	    inflate->Close( e );
+	    if( e->Test() )
+		return;
+
+	    FileSys *raw = FileSys::Create( FST_BINARY );
+	    raw->Set( *inflate->Path() );
+	    raw->Open( FOM_READ, e );
+
+	    char buf[ 65536 ];
+	    int n;
+	    while( !e->Test() && ( n = raw->Read( buf, sizeof( buf ), e ) ) > 0 )
+		data.Append( buf, n );
+
+	    raw->Close( e );
+	    delete raw;
+
+	    inflate->Unlink();
+	    delete inflate;
+	    inflate = 0;
+
+	    // The content is plain now
+	    type = (FileSysType)( ( type & ~FST_MASK ) | FST_BINARY );
+	}
+
+	P4VirtualWorkspace *	ws;
+	StrBuf			data;
+	int			mode;
+	int			offset;
+	FileSys *		inflate;
+};
+
+/*******************************************************************************
+ * P4VirtualWorkspace
+ ******************************************************************************/
+
+P4VirtualWorkspace *
+P4VirtualWorkspace::Create( SV * t )
+{
+	if( !t || !SvROK( t ) )
+	{
+	    warn( "Virtual workspace must be a code ref, hash ref or filehandle" );
+	    return 0;
+	}
+
+	switch( SvTYPE( SvRV( t ) ) )
+	{
+	case SVt_PVCV:
+	    return new P4VirtualWorkspace( VW_CALLBACK, t );
+	case SVt_PVHV:
+	    return new P4VirtualWorkspace( VW_MEMORY, t );
+	case SVt_PVGV:
+	case SVt_PVIO:
+	    if( IoOFP( sv_2io( t ) ) )
+		return new P4VirtualWorkspace( VW_TAR, t );
+	    warn( "Virtual workspace filehandle is not open for writing" );
+	    return 0;
+	default:
+	    warn( "Virtual workspace must be a code ref, hash ref or filehandle" );
+	    return 0;
+	}
+}
+
+P4VirtualWorkspace::P4VirtualWorkspace( Mode m, SV * t )
+{
+	mode = m;
+	target = newSVsv( t );
+	staged = new P4VirtualStaged;
+}
+
+P4VirtualWorkspace::~P4VirtualWorkspace()
+{
+	Flush();
+
+	// End of archive: two empty blocks
+	if( mode == VW_TAR )
+	{
+	    char zero[ 1024 ];
+	    memset( zero, 0, sizeof( zero ) );
+	    TarWrite( zero, sizeof( zero ) );
+	    PerlIO_flush( IoOFP( sv_2io( target ) ) );
+	}
+
+	delete staged;
+	SvREFCNT_dec( target );
+}
+
+int
+P4VirtualWorkspace::Applies( const StrPtr &cmd )
+{
+	return cmd == "sync" || cmd == "update";
+}
+
+FileSys *
+P4VirtualWorkspace::File( FileSysType type )
+{
+	return new P4VirtualFile( this, type );
+}
+
+void
+P4VirtualWorkspace::Stage( const StrPtr &path, StrBuf &data,
+		FileSysType type, int modTime )
+{
+	P4VirtualFileData &f = (*staged)[ std::string( path.Text(), path.Length() ) ];
+
+	f.data.Set( data );
+	f.type = type;
+	f.modTime = modTime;
+}
+
+int
+P4VirtualWorkspace::Rename( const StrPtr &from, const StrPtr &to )
+{
+	P4VirtualStaged::iterator i =
+		staged->find( std::string( from.Text(), from.Length() ) );
+
+	if( i == staged->end() )
+	    return 0;
+
+	Commit( to, i->second.data, i->second.type, i->second.modTime );
+	staged->erase( i );
+	return 1;
+}
+
+void
+P4VirtualWorkspace::Remove( const StrPtr &path )
+{
+	// A temporary file being discarded never reaches Perl
+	if( staged->erase( std::string( path.Text(), path.Length() ) ) )
+	    return;
+
+	if( mode == VW_MEMORY )
+	{
+	    hv_delete( (HV *) SvRV( target ), path.Text(), path.Length(),
+		    G_DISCARD );
+	}
+	else if( mode == VW_CALLBACK )
+	{
+	    dSP;
+	    ENTER;
+	    SAVETMPS;
+	    PUSHMARK( SP );
+	    XPUSHs( sv_2mortal( newSVpv( path.Text(), path.Length() ) ) );
+	    XPUSHs( &PL_sv_undef );
+	    PUTBACK;
+
+	    call_sv( target, G_DISCARD | G_EVAL );
+	    if( SvTRUE( ERRSV ) )
+		warn( "Virtual workspace callback failed: %s",
+			SvPV_nolen( ERRSV ) );
+
+	    FREETMPS;
+	    LEAVE;
+	}
+}
+
+int
+P4VirtualWorkspace::Exists( const StrPtr &path )
+{
+	if( staged->count( std::string( path.Text(), path.Length() ) ) )
+	    return 1;
+
+	return mode == VW_MEMORY && hv_exists( (HV *) SvRV( target ),
+		path.Text(), path.Length() );
+}
+
+int
+P4VirtualWorkspace::Lookup( const StrPtr &path, StrBuf &data )
+{
+	P4VirtualStaged::iterator i =
+		staged->find( std::string( path.Text(), path.Length() ) );
+
+	if( i != staged->end() )
+	{
+	    data.Set( i->second.data );
+	    return 1;
+	}
+
+	if( mode != VW_MEMORY )
+	    return 0;
+
+	SV ** e = hv_fetch( (HV *) SvRV( target ), path.Text(),
+		path.Length(), 0 );
+	if( !e || !SvROK( *e ) || SvTYPE( SvRV( *e ) ) != SVt_PVHV )
+	    return 0;
+
+	SV ** c = hv_fetch( (HV *) SvRV( *e ), "content", 7, 0 );
+	if( !c )
+	    return 0;
+
+	STRLEN len;
+	const char *p = SvPV( *c, len );
+	data.Set( p, (int)len );
+	return 1;
+}
+
+void
+P4VirtualWorkspace::Flush()
+{
+	for( P4VirtualStaged::iterator i = staged->begin(); 
+		i != staged->end(); ++i )
+	{
+	    StrRef path( i->first.c_str(), (int)i->first.size() );
+	    Commit( path, i->second.data, i->second.type, i->second.modTime );
+	}
+	staged->clear();
+}
+
+const char *
+P4VirtualWorkspace::TypeName( FileSysType type )
+{
+	int x = type & FST_M_EXEC;
+
+	switch( type & FST_MASK )
+	{
+	case FST_TEXT:		return x ? "text+x" : "text";
+	case FST_SYMLINK:	return "symlink";
+	case FST_UNICODE:	return x ? "unicode+x" : "unicode";
+	case FST_UTF16:		return x ? "utf16+x" : "utf16";
+	default:		return x ? "binary+x" : "binary";
+	}
+}
+
+void
+P4VirtualWorkspace::Commit( const StrPtr &path, StrBuf &data,
+		FileSysType type, int modTime )
+{
+	if( mode == VW_TAR )
+	{
+	    TarEntry( path, data, type, modTime );
+	    return;
+	}
+
+	StrBuf digest;
+	MD5 md5;
+	md5.Update( data );
+	md5.Final( digest );
+
+	HV * details = newHV();
+	hv_store( details, "type", 4, newSVpv( TypeName( type ), 0 ), 0 );
+	hv_store( details, "digest", 6, 
+		newSVpv( digest.Text(), digest.Length() ), 0 );
+	hv_store( details, "size", 4, newSViv( data.Length() ), 0 );
+
+	SV * content = newSVpv( data.Text(), data.Length() );
+
+	if( mode == VW_MEMORY )
+	{
+	    hv_store( details, "content", 7, content, 0 );
+	    hv_store( (HV *) SvRV( target ), path.Text(), path.Length(),
+		    newRV_noinc( (SV *) details ), 0 );
+	    return;
+	}
+
+	dSP;
+	ENTER;
+	SAVETMPS;
+	PUSHMARK( SP );
+	XPUSHs( sv_2mortal( newSVpv( path.Text(), path.Length() ) ) );
+	XPUSHs( sv_2mortal( content ) );
+	XPUSHs( sv_2mortal( newRV_noinc( (SV *) details ) ) );
+	PUTBACK;
+
+	call_sv( target, G_DISCARD | G_EVAL );
+	if( SvTRUE( ERRSV ) )
+	    warn( "Virtual workspace callback failed: %s", SvPV_nolen( ERRSV ) );
+
+	FREETMPS;
+	LEAVE;
+}
+
+/*
+ * Tar output. Names longer than ustar allows, even split between the name
+ * and prefix fields, go in a GNU long name entry first, as do long symlink
+ * targets; GNU and BSD tar both read these.
+ */
+void
+P4VirtualWorkspace::TarEntry( const StrPtr &path, StrBuf &data,
+		FileSysType type, int modTime )
+{
+	StrBuf name;
+	const char *p = path.Text();
+
+	if( isalpha( (unsigned char) p[ 0 ] ) && p[ 1 ] == ':' )
+	    p += 2;
+	while( *p == '/' || *p == '\\' )
+	    p++;
+	name = p;
+	for( char *c = name.Text(); *c; c++ )
+	    if( *c == '\\' )
+		*c = '/';
+
+	int mode = ( type & FST_M_EXEC ) ? 0755 : 0644;
+
+	if( ( type & FST_MASK ) == FST_SYMLINK )
+	{
+	    if( data.Length() > 100 )
+	    {
+		TarHeader( "././@LongLink", "", 'K', 0, data.Length() + 1, 0 );
+		TarWrite( data.Text(), data.Length() + 1 );
+		TarPad( data.Length() + 1 );
+	    }
+	    TarHeader( name.Text(), data.Text(), '2', 0777, 0, modTime );
+	    return;
+	}
+
+	TarHeader( name.Text(), "", '0', mode, data.Length(), modTime );
+	TarWrite( data.Text(), data.Length() );
+	TarPad( data.Length() );
+}
+
+static void
+TarNumber( char *field, int width, P4INT64 n )
+{
+	// Octal if it fits, otherwise GNU base-256
+	if( n < ( (P4INT64)1 << ( 3 * ( width - 1 ) ) ) )
+	{
+	    for( int i = width - 2; i >= 0; i--, n >>= 3 )
+		field[ i ] = '0' + ( n & 7 );
+	    field[ width - 1 ] = 0;
+	    return;
+	}
+
+	for( int i = width - 1; i > 0; i--, n >>= 8 )
+	    field[ i ] = (char)( n & 0xff );
+	field[ 0 ] = (char)0x80;
+}
+
+void
+P4VirtualWorkspace::TarHeader( const char *name, const char *link,
+		char flag, int mode, P4INT64 size, int modTime )
+{
+	char h[ 512 ];
+	int len = strlen( name );
+
+	memset( h, 0, sizeof( h ) );
+
+	if( len <= 100 )
+	{
+	    memcpy( h, name, len );
+	}
+	else
+	{
+	    // Split at a '/' so the name fits in 100 and the prefix in 155
+	    const char *s = 0;
+	    for( const char *c = name + len - 101; c < name + len; c++ )
+	    {
+		if( *c == '/' && c > name && c - name <= 155 )
+		{
+		    s = c;
+		    break;
+		}
+	    }
+
+	    if( s )
+	    {
+		memcpy( h + 345, name, s - name );
+		memcpy( h, s + 1, len - ( s - name ) - 1 );
+	    }
+	    else
+	    {
+		TarHeader( "././@LongLink", "", 'L', 0, len + 1, 0 );
+		TarWrite( name, len + 1 );
+		TarPad( len + 1 );
+		memcpy( h, name, 100 );
+	    }
+	}
+
+	TarNumber( h + 100, 8, mode );
+	TarNumber( h + 108, 8, 0 );
+	TarNumber( h + 116, 8, 0 );
+	TarNumber( h + 124, 12, size );
+	TarNumber( h + 136, 12, modTime > 0 ? modTime : 0 );
+	h[ 156 ] = flag;
+	strncpy( h + 157, link, 100 );
+	memcpy( h + 257, "ustar", 6 );
+	memcpy( h + 263, "00", 2 );
+
+	unsigned int sum = 0;
+	memset( h + 148, ' ', 8 );
+	for( int i = 0; i < 512; i++ )
+	    sum += (unsigned char) h[ i ];
+	TarNumber( h + 148, 7, sum );
+	h[ 155 ] = ' ';
+
+	TarWrite( h, sizeof( h ) );
+}
+
+void
+P4VirtualWorkspace::TarPad( P4INT64 size )
+{
+	char zero[ 512 ];
+	int pad = (int)( ( 512 - size % 512 ) % 512 );
+
+	memset( zero, 0, pad );
+	TarWrite( zero, pad );
+}
+
+void
+P4VirtualWorkspace::TarWrite( const char *buf, int len )
+{
+	PerlIO * fh = IoOFP( sv_2io( target ) );
+
+	while( len > 0 )
+	{
+	    SSize_t n = PerlIO_write( fh, buf, len );
+	    if( n <= 0 )
+	    {
+		warn( "Unable to write to virtual workspace archive" );
+		return;
+	    }
+	    buf += n;
+	    len -= n;
+	}
+}
@@ -0,0 +1,91 @@
+/*******************************************************************************
+
+Copyright (c) 2016, Perforce Software, Inc.  All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1.  Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+2.  Redistributions in binary form must reproduce the above copyright
+    notice, this list of conditions and the following disclaimer in the
+    documentation and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ARE DISCLAIMED. IN NO EVENT SHALL PERFORCE SOFTWARE, INC. BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+
+/*******************************************************************************
+ * Name		: p4virtualworkspace.h
+ *
+ * Author	: Perforce Software, Inc.
+ *
+ * Description	: A workspace that lives outside the filesystem. Files
+ * 		  synced into it are passed to a Perl callback, stored in
+ * 		  a Perl hash or written to a tar stream.
+ *
+ ******************************************************************************/
+
+struct P4VirtualStaged;
+
+class P4VirtualWorkspace
+{
+    public:
+	enum Mode {
+	    VW_CALLBACK,	// code ref: called with path, content, details
+	    VW_MEMORY,		// hash ref: path => { content, type, ... }
+	    VW_TAR		// filehandle: a ustar archive is written to it
+	};
+
+	// Returns 0 and warns if target isn't one of the above
+	static P4VirtualWorkspace * Create( SV * target );
+
+			~P4VirtualWorkspace();
+
+	// Whether the virtual workspace stands in for the real one during
+	// a command. Only commands that just write workspace files do.
+	static int	Applies( const StrPtr &cmd );
+
+	FileSys *	File( FileSysType type );
+
+	// Called by the files as the client moves them about
+	void		Stage( const StrPtr &path, StrBuf &data,
+				FileSysType type, int modTime );
+	int		Rename( const StrPtr &from, const StrPtr &to );
+	void		Remove( const StrPtr &path );
+	int		Exists( const StrPtr &path );
+	int		Lookup( const StrPtr &path, StrBuf &data );
+
+	// Deliver anything written but not renamed into place
+	void		Flush();
+
+	static const char *	TypeName( FileSysType type );
+
+    private:
+			P4VirtualWorkspace( Mode m, SV * target );
+
+	void		Commit( const StrPtr &path, StrBuf &data,
+				FileSysType type, int modTime );
+	void		TarEntry( const StrPtr &path, StrBuf &data,
+				FileSysType type, int modTime );
+	void		TarHeader( const char *name, const char *link,
+				char flag, int mode, P4INT64 size,
+				int modTime );
+	void		TarWrite( const char *buf, int len );
+	void		TarPad( P4INT64 size );
+
+	Mode		mode;
+	SV *		target;
+	P4VirtualStaged *	staged;
+};
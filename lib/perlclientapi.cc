@@ -46,6 +46,14 @@
 #include "p4perldebug.h"
 #include "specmgr.h"
 #include "perlclientuser.h"
+#include "p4perltimer.h"
+#include "p4runstats.h"
+#include "p4runmemory.h"
+#include "p4resultcache.h"
+#include "p4paralleltransfer.h"
+#include "p4virtualworkspace.h"
+#include "p4synciopolicy.h"
+#include "p4resolvepolicy.h"
 #include "perlclientapi.h"
 
 static Ident
@@ -70,12 +78,18 @@ PerlClientApi::PerlClientApi( HV * args ) {
 	client = new ClientApi;
 	specMgr = new SpecMgr;
 	ui = new PerlClientUser(specMgr);
+	transfer = new P4ParallelTransfer;
+	ui->SetTransfer(transfer);
 	enviro = new Enviro();
 	InitFlags();
 	debug = 0;
 	maxResults = 0;
 	maxScanRows = 0;
 	maxLockTime = 0;
+	resultCache = 0;
+	sizeHint = 0;
+	utf8Mode = 0;
+	printCache = 0;
 	server2 = 0;
 	apiLevel = atoi(P4Tag::l_client);
 	prog = "Unnamed P4Perl script";
@@ -123,9 +137,13 @@ PerlClientApi::PerlClientApi( HV * args ) {
 PerlClientApi::~PerlClientApi() {
 	Disconnect();
 	delete ui;
+	delete transfer;
 	delete client;
 	delete specMgr;
 	delete enviro;
+	delete resultCache;
+	if (printCache)
+		SvREFCNT_dec(printCache);
 }
 
 SV *
@@ -204,6 +222,7 @@ PerlClientApi::SetCharset(const char *c) {
 	  client->SetTrans( utf8, cs, utf8, utf8 );
 	  client->SetCharset(c);
 	}
+	ApplyUtf8Mode();
 	return &PL_sv_yes;
 }
 
@@ -455,6 +474,11 @@ PerlClientApi::GetTrackOutput() {
 	return ui->GetResults().GetTrack();
 }
 
+SV *
+PerlClientApi::GetTrackStats() {
+	return ui->GetTrackStats();
+}
+
 I32 PerlClientApi::GetOutputCount() {
 	return ui->GetResults().OutputCount();
 }
@@ -474,6 +498,7 @@ I32 PerlClientApi::GetTrackOutputCount() {
 void PerlClientApi::SetDebugLevel(int l) {
 	debug = l;
 	ui->SetDebugLevel(l);
+	transfer->SetDebugLevel(l);
 	specMgr->SetDebug(l);
 	if (P4PERL_DEBUG_RPC)
 		p4debug.SetLevel(DT_RPC, 5);
@@ -503,16 +528,176 @@ void PerlClientApi::SetProgress(SV * p) {
 	}
 }
 
+void PerlClientApi::SetProgressRate(int interval, long delta) {
+	ui->SetProgressRate(interval, delta);
+}
+
+void PerlClientApi::SetProgressStats(int enable) {
+	ui->SetProgressStats(enable);
+}
+
+void PerlClientApi::SetRunStats(int enable) {
+	ui->SetRunStats(enable);
+}
+
+SV *
+PerlClientApi::GetRunStats() {
+	P4RunStats * stats = ui->GetRunStats();
+	if (!stats)
+		return &PL_sv_undef;
+	return newRV_noinc((SV *) stats->ToHash());
+}
+
+void PerlClientApi::SetRunMemory(int enable) {
+	ui->SetRunMemory(enable);
+}
+
+SV *
+PerlClientApi::GetRunMemory() {
+	P4RunMemory * mem = ui->GetRunMemory();
+	if (!mem)
+		return &PL_sv_undef;
+	return newRV_noinc((SV *) mem->ToHash());
+}
+
+/*
+ * Enable the result cache with the given size limit in bytes, or disable
+ * it and discard its contents if bytes is zero.
+ */
+void PerlClientApi::SetResultCache(long bytes) {
+	if (bytes <= 0) {
+		delete resultCache;
+		resultCache = 0;
+	} else if (resultCache)
+		resultCache->SetLimit(bytes);
+	else
+		resultCache = new P4ResultCache(bytes);
+}
+
+void PerlClientApi::ClearResultCache() {
+	if (resultCache)
+		resultCache->Clear();
+}
+
+SV *
+PerlClientApi::GetResultCacheStats() {
+	if (!resultCache)
+		return &PL_sv_undef;
+	return newRV_noinc((SV *) resultCache->Stats());
+}
+
+/*
+ * The print cache is a P4::PrintCache object, which P4::Run consults for
+ * 'print' commands. We just hold on to it.
+ */
+void PerlClientApi::SetPrintCache(SV * cache) {
+	if (printCache)
+		SvREFCNT_dec(printCache);
+	printCache = 0;
+
+	if (sv_isobject(cache))
+		printCache = newSVsv(cache);
+	else if (SvOK(cache))
+		warn("Unable to SetPrintCache, not an object.");
+}
+
+//
+// If active is set, the cache is only returned if it may be used for the
+// next command: it's bypassed while an output handler is set, as the
+// handler expects to see output as it arrives from the server.
+//
+SV *
+PerlClientApi::GetPrintCache(int active) {
+	if (!printCache || (active && ui->GetHandler()))
+		return &PL_sv_undef;
+	return newSVsv(printCache);
+}
+
+void PerlClientApi::ResetResults() {
+	ui->Reset();
+}
+
+//
+// Everything about the connection that affects what a cached command
+// returns, or the form it's returned in.
+//
+void PerlClientApi::CacheIdent(StrBuf &ident) {
+	ident << client->GetPort() << "\n";
+	ident << client->GetUser() << "\n";
+	ident << client->GetClient() << "\n";
+	ident << client->GetCharset() << "\n";
+	ident << apiLevel << (IsTag() ? "t" : "u") << utf8Mode;
+}
+
+SV *
+PerlClientApi::GetProgressStats() {
+	HV * hv = ui->GetProgressStats();
+	if (!hv)
+		return &PL_sv_undef;
+	return newRV_noinc((SV *) hv);
+}
+
 void PerlClientApi::SetResolver(SV * r) {
 	ui->SetResolver(r);
 }
 
+void PerlClientApi::SetAutoResolve(int a) {
+	ui->SetAutoResolve(a);
+}
+
+int PerlClientApi::GetAutoResolve() {
+	return ui->GetAutoResolve();
+}
+
+//
+// Rules are matched with the server's case sensitivity if we know it;
+// before connecting we assume case matters.
+//
+void PerlClientApi::SetResolvePolicy(SV * rules) {
+	if (!rules || !SvROK(rules) || SvTYPE(SvRV(rules)) != SVt_PVAV) {
+		if (rules && SvOK(rules))
+			warn("Resolve policy must be an array ref or undef");
+		ui->SetResolvePolicy(0);
+		return;
+	}
+
+	P4ResolvePolicy * p = new P4ResolvePolicy;
+	int sensitive = !IsConnected() || ServerCaseSensitive();
+
+	if (!p->Configure((AV *) SvRV(rules), sensitive)) {
+		delete p;
+		p = 0;
+	}
+	ui->SetResolvePolicy(p);
+}
+
 AV *
 PerlClientApi::Run(const char *cmd, int argc, char * const *argv) {
 	StrBuf cmdstr;
 
 	ui->Reset();
 	ui->SetCommand(cmd);
+	ui->GetResults().SetSizeHint(OutputSizeHint(cmd, argc, argv));
+
+	//
+	// Submits go over parallel connections if SetParallelSubmit() asked
+	// for it, unless the caller has chosen for themselves.
+	//
+	char ** pargv = 0;
+	if (parallelSubmit.Length() && !strcmp(cmd, "submit")) {
+		int given = 0;
+		for (int i = 0; i < argc && !given; i++)
+			given = !strncmp(argv[i], "--parallel", 10);
+
+		if (!given) {
+			pargv = new char *[argc + 1];
+			pargv[0] = parallelSubmit.Text();
+			for (int i = 0; i < argc; i++)
+				pargv[i + 1] = argv[i];
+			argv = pargv;
+			argc++;
+		}
+	}
 
 	if (P4PERL_DEBUG_CMDS) {
 		cmdstr << cmd;
@@ -523,7 +708,34 @@ PerlClientApi::Run(const char *cmd, int argc, char * const *argv) {
 		PerlIO_stdoutf("[P4]: Executing: 'p4 %s'\n", cmdstr.Text());
 	}
 
+	//
+	// Commands with immutable results may be answered from the cache.
+	// Anything with an output handler always goes to the server, as the
+	// handler expects to see the output as it arrives.
+	//
+	StrBuf ident;
+	SV * handler = ui->GetHandler();
+	int cacheable = resultCache && !(handler && SvOK(handler))
+			&& P4ResultCache::Cacheable(cmd, argc, argv, IsTag());
+
+	if (cacheable) {
+		CacheIdent(ident);
+		if (resultCache->Fetch(ident, cmd, argc, argv, ui->GetResults())) {
+			if (P4PERL_DEBUG_CMDS)
+				PerlIO_stdoutf("[P4]: Cached: 'p4 %s'\n", cmdstr.Text());
+			return GetOutput();
+		}
+	}
+
 	RunCmd(cmd, ui, argc, argv);
+	delete[] pargv;
+
+	if (cacheable) {
+		P4Result & r = ui->GetResults();
+		if (!r.ErrorCount() && !r.WarningCount()
+				&& P4ResultCache::Storable(cmd, r.GetOutputInternal()))
+			resultCache->Store(ident, cmd, argc, argv, r.GetOutputInternal());
+	}
 
 	//
 	// Save the specdef for this command...
@@ -537,8 +749,137 @@ PerlClientApi::Run(const char *cmd, int argc, char * const *argv) {
 	return GetOutput();
 }
 
+//
+// Options for 'submit --parallel', added to every submit. Zero threads
+// turns it off again; zero for any of the others leaves the server's
+// net.parallel.submit.* setting in force.
+//
+void PerlClientApi::SetParallelSubmit(int threads, int batch, int min,
+		long minsize) {
+	parallelSubmit.Clear();
+	if (threads <= 0)
+		return;
+
+	parallelSubmit << "--parallel=threads=" << threads;
+	if (batch > 0)
+		parallelSubmit << ",batch=" << batch;
+	if (min > 0)
+		parallelSubmit << ",min=" << min;
+	if (minsize > 0)
+		parallelSubmit << ",minsize=" << StrNum((P4INT64) minsize);
+}
+
+//
+// Sync into a code ref, hash ref or filehandle instead of the client's
+// root; undef goes back to the real workspace. Transfers stay on this
+// connection while it's set, as the callbacks have to run on this thread.
+//
+void PerlClientApi::SetVirtualWorkspace(SV * target) {
+	P4VirtualWorkspace * w = 0;
+
+	if (target && SvOK(target)) {
+		w = P4VirtualWorkspace::Create(target);
+		if (!w)
+			return;
+	}
+
+	ui->SetVirtualWorkspace(w);
+	ui->SetTransfer(w ? 0 : transfer);
+}
+
+//
+// How sync writes files: see P4SyncIOPolicy. Anything other than a hash
+// ref goes back to the API's defaults.
+//
+void PerlClientApi::SetSyncIOPolicy(SV * options) {
+	P4SyncIOPolicy * p = 0;
+
+	if (options && SvROK(options) && SvTYPE(SvRV(options)) == SVt_PVHV) {
+		p = new P4SyncIOPolicy;
+		p->Configure((HV *) SvRV(options));
+	}
+	ui->SetSyncIOPolicy(p);
+}
+
+SV *
+PerlClientApi::GetSyncIOPolicy() {
+	P4SyncIOPolicy * p = ui->GetSyncIOPolicy();
+	if (!p)
+		return &PL_sv_undef;
+	return newRV_noinc((SV *) p->GetOptions());
+}
+
+//
+// Estimate how many records the next command will return: an explicit
+// hint from SetResultSizeHint() applies to one command only; failing that
+// a -m argument or the maxResults limit gives an upper bound. These are
+// only taken as a bound for the commands where they limit the number of
+// output records; elsewhere it means something else (filelog's revisions per
+// file, for instance) or a record may expand into several (print).
+//
+static const char * const boundedCommands[] = {
+	"branches", "changes", "changelists", "clients", "files", "fixes",
+	"fstat", "jobs", "labels", "opened", "streams", "users", "workspaces",
+	0
+};
+
+int PerlClientApi::OutputSizeHint(const char *cmd, int argc,
+		char * const *argv) {
+	if (sizeHint) {
+		int n = sizeHint;
+		sizeHint = 0;
+		return n;
+	}
+
+	int bounded = 0;
+	for (const char * const *c = boundedCommands; *c && !bounded; c++)
+		bounded = !strcmp(cmd, *c);
+
+	for (int i = 0; bounded && i < argc; i++) {
+		if (!strcmp(argv[i], "--"))
+			break;
+		if (!strncmp(argv[i], "-m", 2)) {
+			const char *n = argv[i][2] ? argv[i] + 2
+					: (i + 1 < argc ? argv[i + 1] : "");
+			if (isdigit((unsigned char) *n))
+				return atoi(n);
+		}
+	}
+
+	// maxResults is a limit on rows the server scans, not a size: it
+	// only bounds the output of the same commands
+	return bounded ? maxResults : 0;
+}
+
+void PerlClientApi::SetOutputUtf8(int mode) {
+	utf8Mode = mode;
+	ApplyUtf8Mode();
+}
+
+//
+// Output is only flagged as UTF-8 when a charset has been set, in which
+// case SetCharset() has asked for output translated to UTF-8. File content
+// is translated to the charset itself, so text output is only flagged if
+// that's UTF-8 too.
+//
+void PerlClientApi::ApplyUtf8Mode() {
+	const StrPtr &cs = client->GetCharset();
+	int output = 0;
+	int text = 0;
+
+	if (utf8Mode && cs.Length() && cs != "none") {
+		output = utf8Mode;
+		if (cs == "utf8" || cs == "utf8-bom")
+			text = utf8Mode;
+	}
+
+	ui->SetUtf8Mode(output, text);
+	specMgr->SetUtf8Mode(output);
+}
+
 void PerlClientApi::RunCmd(const char *cmd, ClientUser *ui, int argc,
 		char * const *argv) {
+	ApplyUtf8Mode();
 	client->SetProg(prog.Text());
 	if (version.Length())
 		client->SetVersion(&version);
@@ -558,13 +899,31 @@ void PerlClientApi::RunCmd(const char *cmd, ClientUser *ui, int argc,
 		client->SetVar("maxLockTime", maxLockTime);
 
     // If progress is set, set the progress var
-    if( ((PerlClientUser*)ui)->GetProgress() != 0 ){
+    if( ((PerlClientUser*)ui)->ProgressIndicator() ){
     	client->SetVar( P4Tag::v_progress, 1);
 	}
 
+	P4RunStats * stats = ((PerlClientUser*)ui)->GetRunStats();
+	if (stats)
+		stats->Start(cmd);
+
+	P4RunMemory * mem = ((PerlClientUser*)ui)->GetRunMemory();
+	if (mem)
+		mem->Start();
+
+	// Parallel sync threads write files under the same policy
+	P4SyncIOPolicy * io = ((PerlClientUser*)ui)->GetSyncIOPolicy();
+	transfer->SetSyncIOPolicy(io && P4SyncIOPolicy::Applies(StrRef(cmd))
+			? io : 0);
+
 	client->SetArgv(argc, argv);
 	client->Run(cmd, ui);
 
+	if (stats)
+		stats->Stop();
+	if (mem)
+		mem->Finish(((PerlClientUser*)ui)->GetResults());
+
 	// Have to request server2 protocol *after* a command has been run.
 	// Do this once only
 
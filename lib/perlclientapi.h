@@ -27,6 +27,8 @@ class ClientApi;
 class PerlClientUser;
 class SpecMgr;
 class Enviro;
+class P4ResultCache;
+class P4ParallelTransfer;
 
 class PerlClientApi {
 public:
@@ -54,12 +56,36 @@ public:
 	void ClearHandler();
 	void SetHandler(SV *i);
 	void SetProgress(SV *p);
+	void SetProgressRate(int interval, long delta);
+	void SetProgressStats(int enable);
+	SV * GetProgressStats();
+	void SetRunStats(int enable);
+	SV * GetRunStats();
+	void SetRunMemory(int enable);
+	SV * GetRunMemory();
+	void SetResultCache(long bytes);
+	void ClearResultCache();
+	SV * GetResultCacheStats();
+	void SetPrintCache(SV * cache);
+	SV * GetPrintCache(int active);
+	void ResetResults();
 	void SetLanguage(const char *c) {
 		client->SetLanguage(c);
 	}
 	void SetPassword(const char *c) {
 		client->SetPassword(c);
 	}
+	void SetOutputUtf8(int mode);
+	int GetOutputUtf8() {
+		return utf8Mode;
+	}
+	void SetResultSizeHint(int n) {
+		sizeHint = n;
+	}
+	void SetParallelSubmit(int threads, int batch, int min, long minsize);
+	void SetVirtualWorkspace(SV * target);
+	void SetSyncIOPolicy(SV * options);
+	SV * GetSyncIOPolicy();
 	void SetMaxResults(int v) {
 		maxResults = v;
 	}
@@ -82,6 +108,9 @@ public:
 		prog.Set(c);
 	}
 	void SetResolver(SV * r);
+	void SetResolvePolicy(SV * rules);
+	void SetAutoResolve(int a);
+	int GetAutoResolve();
 	void SetVersion(const char *v) {
 		version.Set(v);
 	}
@@ -138,6 +167,7 @@ public:
 	AV * GetErrors();
 	AV * GetMessages();
 	AV * GetTrackOutput();
+	SV * GetTrackStats();
 
 	I32 GetOutputCount();
 	I32 GetWarningCount();
@@ -250,6 +280,10 @@ private:
 	}
 
 private:
+	void CacheIdent(StrBuf &ident);
+	int OutputSizeHint(const char *cmd, int argc, char * const *argv);
+	void ApplyUtf8Mode();
+
 	ClientApi * client;
 	PerlClientUser * ui;
 	Enviro * enviro;
@@ -266,4 +300,10 @@ private:
 	int maxResults;
 	int maxScanRows;
 	int maxLockTime;
+	P4ResultCache * resultCache;
+	P4ParallelTransfer * transfer;
+	int sizeHint;
+	StrBuf parallelSubmit;
+	int utf8Mode;
+	SV * printCache;
 };
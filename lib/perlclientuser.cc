@@ -47,6 +47,16 @@
 #include "p4mergedata.h"
 #include "p4actionmerge.h"
 #include "p4clientprogress.h"
+#include "p4progressstats.h"
+#include "p4perltimer.h"
+#include "p4runstats.h"
+#include "p4runmemory.h"
+#include "p4trackstats.h"
+#include "p4utf8.h"
+#include "p4virtualworkspace.h"
+#include "p4synciopolicy.h"
+#include "p4resolvepolicy.h"
+#include "p4nativehandler.h"
 #include "perlclientuser.h"
 
 /*******************************************************************************
@@ -61,11 +71,31 @@ PerlClientUser::PerlClientUser(SpecMgr *s) {
 	specMgr = s;
 	alive = 1;
 	handler = 0;
+	native = 0;
 	progress = 0;
+	progressInterval = 0;
+	progressDelta = 0;
+	progressStats = 0;
+	runStats = 0;
+	runMemory = 0;
+	trackStats = 0;
+	workspace = 0;
+	syncPolicy = 0;
+	resolvePolicy = 0;
+	autoResolve = 0;
+	outputUtf8 = 0;
+	textUtf8 = 0;
 }
 
 
 PerlClientUser::~PerlClientUser() {
+	delete progressStats;
+	delete runStats;
+	delete runMemory;
+	delete trackStats;
+	delete workspace;
+	delete syncPolicy;
+	delete resolvePolicy;
 //	if (progress) {
 //		delete progress;
 //	}
@@ -74,6 +104,10 @@ PerlClientUser::~PerlClientUser() {
 void PerlClientUser::Reset() {
 	results.Reset();
 	lastSpecDef.Clear();
+	if (progressStats)
+		progressStats->Reset();
+	if (trackStats)
+		trackStats->Reset();
 	// Leave input alone.
 
 	alive = 1; // yes, we want data from the server
@@ -91,6 +125,15 @@ void PerlClientUser::Finished() {
 	}
 	resolver = 0;
 	handler = 0; // should I use: &PL_sv_undef?
+	native = 0;
+
+	// Deliver any virtual files that weren't renamed into place
+	if (workspace)
+		workspace->Flush();
+
+	// and don't return until the last of the files are on disk
+	if (syncPolicy)
+		syncPolicy->Finish();
 }
 
 /*
@@ -117,6 +160,8 @@ bool PerlClientUser::CallOutputMethod(const char * method, SV * data) {
 		return true;
 	}
 
+	double t0 = runStats ? P4PerlTimer::Now() : 0;
+
 	// Nasty perl stuff to call 'method' on the 'iterator' class passing 'data'
 	dSP;
 	int a;
@@ -141,6 +186,9 @@ bool PerlClientUser::CallOutputMethod(const char * method, SV * data) {
 	FREETMPS;
 	LEAVE;
 
+	if (runStats)
+		runStats->callback += P4PerlTimer::Now() - t0;
+
 	if (answer > 3) {
 		// exception: bad value
 		alive = 0;
@@ -155,7 +203,20 @@ bool PerlClientUser::CallOutputMethod(const char * method, SV * data) {
 }
 
 void PerlClientUser::ProcessOutput(const char * method, SV * data) {
-	if (handler) {
+	if (runStats)
+		runStats->records++;
+	if (runMemory)
+		runMemory->AddRecord(data);
+
+	if (native) {
+		int answer = native->Output(method, data);
+		if (answer & CANCEL)
+			alive = 0;
+		if (answer & HANDLED)
+			SvREFCNT_dec(data);
+		else
+			results.AddOutput(data);
+	} else if (handler) {
 		if (CallOutputMethod(method, data)) {
 			results.AddOutput(data);
 			if (P4PERL_DEBUG_FLOW)
@@ -167,7 +228,7 @@ void PerlClientUser::ProcessOutput(const char * method, SV * data) {
 }
 
 void PerlClientUser::ProcessMessage(Error *e) {
-	if (handler) {
+	if (handler && !native) {
 		if (CallOutputMethod("OutputMessage", (SV *) e)) {
 			results.AddMessage(e);
 		}
@@ -179,6 +240,9 @@ void PerlClientUser::Message(Error *e) {
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[PerlClientUser:Message]: Received message\n");
 
+	if (runStats)
+		runStats->messages++;
+
 	results.AddMessage(e);
 }
 
@@ -186,6 +250,9 @@ void PerlClientUser::HandleError(Error *e) {
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[PerlClientUser:Message]: Received message\n");
 
+	if (runStats)
+		runStats->messages++;
+
 	results.AddMessage(e);
 }
 
@@ -194,6 +261,9 @@ void PerlClientUser::OutputText(const char *data, int length) {
 		PerlIO_stdoutf("[PerlClientUser::OutputText]: Received %d bytes\n",
 				length);
 
+	if (runStats)
+		runStats->bytes += length;
+
 	if (track && length > 3 && data[0] == '-' && data[1] == '-'
 			&& data[2] == '-' && data[3] == ' ') {
 		int p = 4;
@@ -201,19 +271,25 @@ void PerlClientUser::OutputText(const char *data, int length) {
 			if (data[i] == '\n') {
 				if (i > p) {
 					results.AddTrack(newSVpv(data + p, i - p));
+					if (trackStats)
+						trackStats->Parse(data + p, i - p);
 					p = i + 5;
 				} else {
 					// this was not track data after all,
 					// try to rollback the damage done
 					results.AddOutput(newSVpv(data, length));
 					results.DeleteTrack();
+					if (trackStats)
+						trackStats->Reset();
 
 					return;
 				}
 			}
 		}
 	} else {
-		ProcessOutput("OutputText", newSVpv(data, length));
+		SV * sv = newSVpv(data, length);
+		P4Utf8::Mark(sv, textUtf8);
+		ProcessOutput("OutputText", sv);
 	}
 }
 
@@ -221,7 +297,12 @@ void PerlClientUser::OutputInfo(char level, const char *data) {
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[PerlClientUser::OutputInfo]: Received data\n");
 
-	ProcessOutput("OutputInfo", newSVpv(data, 0));
+	if (runStats)
+		runStats->bytes += strlen(data);
+
+	SV * sv = newSVpv(data, 0);
+	P4Utf8::Mark(sv, outputUtf8);
+	ProcessOutput("OutputInfo", sv);
 }
 
 void PerlClientUser::OutputBinary(const char *data, int length) {
@@ -229,6 +310,9 @@ void PerlClientUser::OutputBinary(const char *data, int length) {
 		PerlIO_stdoutf("[PerlClientUser::OutputBinary]: Received %d bytes\n",
 				length);
 
+	if (runStats)
+		runStats->bytes += length;
+
 	//
 	// Binary is just stored in a string. Since the char * version of
 	// P4Result::AddOutput() assumes it can strlen() to find the length,
@@ -249,6 +333,14 @@ void PerlClientUser::OutputStat(StrDict *values) {
 		PerlIO_stdoutf(
 				"[PerlClientUser::OutputStat]: Received tagged output\n");
 
+	double t0 = 0;
+	if (runStats) {
+		StrRef var, val;
+		for (int i = 0; values->GetVar(i, var, val); i++)
+			runStats->bytes += var.Length() + val.Length();
+		t0 = P4PerlTimer::Now();
+	}
+
 	//
 	// Determine whether or not the data we've got contains a spec in one form
 	// or another. 2000.1 -> 2005.1 servers supplied the form in a data variable
@@ -291,6 +383,22 @@ void PerlClientUser::OutputStat(StrDict *values) {
 		dict = specData.Dict();
 	}
 
+	//
+	// A native handler sees the record before it's converted. Anything
+	// it deals with never becomes a Perl hash; the rest carries on as
+	// usual.
+	//
+	if (native) {
+		int answer = native->OutputStat(dict, outputUtf8);
+		if (answer & CANCEL)
+			alive = 0;
+		if (answer & HANDLED) {
+			if (runStats)
+				runStats->records++;
+			return;
+		}
+	}
+
 	//
 	// If what we've got is a parsed form, then we'll convert it to a P4::Spec
 	// object. Otherwise it's a plain hash.
@@ -310,6 +418,13 @@ void PerlClientUser::OutputStat(StrDict *values) {
 		r = specMgr->StrDictToHash(dict);
 	}
 
+	if (runStats) {
+		if (isspec)
+			runStats->spec += P4PerlTimer::Now() - t0;
+		else
+			runStats->convert += P4PerlTimer::Now() - t0;
+	}
+
 	ProcessOutput("OutputStat", r);
 }
 
@@ -370,8 +485,11 @@ void PerlClientUser::Diff(FileSys *f1, FileSys *f2, int doPage, char *diffFlags,
 			t->Open(FOM_READ, e);
 		if (!e->Test()) {
 			StrBuf b;
-			while (t->ReadLine(&b, e))
-				results.AddOutput(newSVpv(b.Text(), b.Length()));
+			while (t->ReadLine(&b, e)) {
+				SV * sv = newSVpv(b.Text(), b.Length());
+				P4Utf8::Mark(sv, textUtf8);
+				results.AddOutput(sv);
+			}
 		}
 	}
 
@@ -393,19 +511,41 @@ int PerlClientUser::Resolve(ClientMerge *m, Error *e) {
 		PerlIO_stdoutf("[PerlClientUser::Resolve(Action)]: Resolving... \n");
 
 	//
-	// If no resolver has been set, abort the resolve...
+	// A resolve policy may settle it without a trip into Perl
 	//
-	if (!resolver) {
-		warn("No P4::Resolver object supplied. Aborting resolve");
-		return CMS_QUIT;
+	MergeStatus decided;
+	if (resolvePolicy && resolvePolicy->Decide(m, varList, decided))
+		return decided;
+
+	//
+	// In auto resolve mode, whatever 'resolve -am' would accept is simply
+	// accepted. That leaves conflicts, including binary files changed on
+	// both sides, to the resolver.
+	//
+	if (autoResolve) {
+		MergeStatus safe = m->AutoResolve(CMF_AUTO);
+		if (safe == CMS_THEIRS || safe == CMS_YOURS || safe == CMS_MERGED)
+			return safe;
 	}
 
 	//
-	// First detect what the merger thinks the result ought to be
+	// Otherwise detect what the merger thinks the result ought to be, as
+	// the hint for the resolver.
 	//
 	StrBuf t;
 	MergeStatus autoMerge = m->AutoResolve(CMF_FORCE);
 
+	//
+	// If no resolver has been set, abort the resolve; unless there's a
+	// policy or auto resolve, in which case what's left is skipped.
+	//
+	if (!resolver) {
+		if (resolvePolicy || autoResolve)
+			return CMS_SKIP;
+		warn("No P4::Resolver object supplied. Aborting resolve");
+		return CMS_QUIT;
+	}
+
 	// Now convert that to a string;
 	switch (autoMerge) {
 	case CMS_QUIT:
@@ -492,9 +632,35 @@ int PerlClientUser::Resolve(ClientResolveA *m, int preview, Error *e) {
 		PerlIO_stdoutf("[PerlClientUser::Resolve]: Resolving... \n");
 
 	//
-	// If no resolver has been set, abort the resolve...
+	// A resolve policy may settle it without a trip into Perl. The
+	// names are in the output record describing the resolve.
+	//
+	if (resolvePolicy) {
+		AV *output = results.GetOutputInternal();
+		SV **info = av_fetch(output, av_len(output), 0);
+		MergeStatus decided;
+
+		if (resolvePolicy->Decide(m, varList, info ? *info : 0, decided))
+			return decided;
+	}
+
+	//
+	// In auto resolve mode, take the safe suggestion where there is one;
+	// a skip means both sides acted and someone has to decide.
+	//
+	if (autoResolve) {
+		MergeStatus safe = m->AutoResolve(CMF_SAFE);
+		if (safe == CMS_THEIRS || safe == CMS_YOURS || safe == CMS_MERGED)
+			return safe;
+	}
+
+	//
+	// If no resolver has been set, abort the resolve; unless there's a
+	// policy or auto resolve, in which case what's left is skipped.
 	//
 	if (!resolver) {
+		if (resolvePolicy || autoResolve)
+			return CMS_SKIP;
 		warn("No P4::Resolver (action) object supplied. Aborting resolve");
 		return CMS_QUIT;
 	}
@@ -645,9 +811,28 @@ void PerlClientUser::InputData(StrBuf *strbuf, Error *e) {
 		if (P4PERL_DEBUG_DATA)
 			PerlIO_stdoutf("[PerlClientUser::InputData]: Input is a hashref."
 					" Formatting...\n");
-		StrPtr * specDef = varList->GetVar("specdef");
-		specMgr->AddSpecDef(cmd.Text(), specDef->Text());
-		specMgr->SpecToString(cmd.Text(), (HV *) s, *strbuf, e);
+		InputSpec((HV *) s, strbuf, e);
+		return;
+	}
+
+	//
+	// Filehandles and code refs let large inputs be generated or read
+	// as they're needed, rather than held in memory as a Perl string as
+	// well as in the buffer we pass to the server.
+	//
+	if (SvTYPE(s) == SVt_PVGV || SvTYPE(s) == SVt_PVIO) {
+		if (P4PERL_DEBUG_DATA)
+			PerlIO_stdoutf("[PerlClientUser::InputData]: Input is a "
+					"filehandle. Reading...\n");
+		InputHandle(s, strbuf, e);
+		return;
+	}
+
+	if (SvTYPE(s) == SVt_PVCV) {
+		if (P4PERL_DEBUG_DATA)
+			PerlIO_stdoutf("[PerlClientUser::InputData]: Input is a "
+					"code ref. Calling...\n");
+		InputCallback(s, strbuf, e);
 		return;
 	}
 
@@ -657,6 +842,96 @@ void PerlClientUser::InputData(StrBuf *strbuf, Error *e) {
 	strbuf->Set(SvPV_nolen(s));
 }
 
+void PerlClientUser::InputSpec(HV * hv, StrBuf *strbuf, Error *e) {
+	StrPtr * specDef = varList->GetVar("specdef");
+	specMgr->AddSpecDef(cmd.Text(), specDef->Text());
+	specMgr->SpecToString(cmd.Text(), hv, *strbuf, e);
+}
+
+/*
+ * Read the whole of a filehandle straight into the input buffer.
+ */
+void PerlClientUser::InputHandle(SV * fh, StrBuf *strbuf, Error *e) {
+	const int chunk = 64 * 1024;
+	IO * io = SvTYPE(fh) == SVt_PVGV ? GvIO((GV *) fh) : (IO *) fh;
+	PerlIO * fp = io ? IoIFP(io) : 0;
+
+	if (!fp) {
+		warn("Input filehandle is not open for reading");
+		e->Set(E_FAILED, "Unable to read input");
+		return;
+	}
+
+	strbuf->Clear();
+	for (;;) {
+		int len = strbuf->Length();
+		SSize_t n = PerlIO_read(fp, strbuf->Alloc(chunk), chunk);
+		strbuf->SetLength(len + (n > 0 ? n : 0));
+		if (n <= 0)
+			break;
+	}
+	strbuf->Terminate();
+
+	if (PerlIO_error(fp)) {
+		warn("Error reading from input filehandle");
+		e->Set(E_FAILED, "Unable to read input");
+	}
+}
+
+/*
+ * Call a code ref repeatedly, appending each string it returns to the
+ * input until it returns undef or an empty string. If the first thing
+ * it returns is a hash ref, that's formatted as a spec instead.
+ */
+void PerlClientUser::InputCallback(SV * code, StrBuf *strbuf, Error *e) {
+	strbuf->Clear();
+
+	for (int done = 0; !done;) {
+		dSP;
+		int n;
+
+		ENTER;
+		SAVETMPS;
+
+		PUSHMARK(SP);
+		PUTBACK;
+
+		n = call_sv(code, G_SCALAR | G_EVAL | G_NOARGS);
+		SPAGAIN;
+
+		SV * chunk = n >= 1 ? POPs : &PL_sv_undef;
+
+		if (SvTRUE(ERRSV)) {
+			warn("Input callback failed: %s", SvPV_nolen(ERRSV));
+			e->Set(E_FAILED, "Unable to read input");
+			done = 1;
+		} else if (!SvOK(chunk)) {
+			done = 1;
+		} else if (SvROK(chunk)) {
+			// Only a spec, and only on its own, may come as a reference
+			if (SvTYPE(SvRV(chunk)) == SVt_PVHV && !strbuf->Length()) {
+				InputSpec((HV *) SvRV(chunk), strbuf, e);
+			} else {
+				warn("Input callback returned a reference where a string "
+						"was expected");
+				e->Set(E_FAILED, "Unable to read input");
+			}
+			done = 1;
+		} else {
+			STRLEN len;
+			const char * p = SvPV(chunk, len);
+			if (len)
+				strbuf->Append(p, len);
+			else
+				done = 1;
+		}
+
+		PUTBACK;
+		FREETMPS;
+		LEAVE;
+	}
+}
+
 /*
  * Accept input from Perl for later use. We just save what we're given here 
  * because we may not have the specdef available to parse it with at this time.
@@ -684,6 +959,7 @@ void PerlClientUser::ClearHandler() {
 	if (handler) {
 		sv_free(handler);
 	}
+	native = 0;
 }
 
 void PerlClientUser::SetHandler(SV * i) {
@@ -692,6 +968,10 @@ void PerlClientUser::SetHandler(SV * i) {
 
 	handler = i;
 	alive = 1;
+
+	// Our own handlers are dealt with without calling into Perl
+	native = sv_derived_from(i, "P4::Handler") ?
+			INT2PTR(P4NativeHandler *, SvIV(SvRV(i))) : 0;
 }
 
 SV *
@@ -716,7 +996,7 @@ int PerlClientUser::ProgressIndicator()
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[PerlClientUser:ProgressIndicator]:\n");
 
-	int result = (progress != 0);
+	int result = (progress != 0 || progressStats != 0);
 	return result;
 }
 
@@ -729,10 +1009,51 @@ PerlClientUser::CreateProgress(int type)
 	if (P4PERL_DEBUG_FLOW)
 		PerlIO_stdoutf("[PerlClientUser:CreateProgress]: type: %d\n", type);
 
-	if (progress == 0) {
+	if (progress == 0 && progressStats == 0) {
 		return 0;
 	}
-	return new P4ClientProgress(progress, type);
+	P4ClientProgress *p = new P4ClientProgress(progress, type, progressStats);
+	p->SetRate(progressInterval, progressDelta);
+	return p;
+}
+
+/*
+ * While a virtual workspace is set, files written by sync go to it rather
+ * than to disk; failing that, a sync IO policy may change how they're
+ * written. Everything else still uses the API's own files.
+ */
+FileSys *
+PerlClientUser::File(FileSysType type) {
+	if (workspace && P4VirtualWorkspace::Applies(cmd))
+		return workspace->File(type);
+
+	if (syncPolicy && P4SyncIOPolicy::Applies(cmd))
+		return syncPolicy->File(type, varList);
+
+	return ClientUser::File(type);
+}
+
+void PerlClientUser::SetVirtualWorkspace(P4VirtualWorkspace * w) {
+	if (P4PERL_DEBUG_FLOW)
+		PerlIO_stdoutf("[PerlClientUser::SetVirtualWorkspace]: %s\n",
+				w ? "on" : "off");
+
+	delete workspace;
+	workspace = w;
+}
+
+void PerlClientUser::SetResolvePolicy(P4ResolvePolicy * p) {
+	delete resolvePolicy;
+	resolvePolicy = p;
+}
+
+void PerlClientUser::SetSyncIOPolicy(P4SyncIOPolicy * p) {
+	if (P4PERL_DEBUG_FLOW)
+		PerlIO_stdoutf("[PerlClientUser::SetSyncIOPolicy]: %s\n",
+				p ? "on" : "off");
+
+	delete syncPolicy;
+	syncPolicy = p;
 }
 
 /*
@@ -760,6 +1081,80 @@ PerlClientUser::GetProgress()
 	return progress;
 }
 
+/*
+ * Enable or disable the native progress statistics. These are recorded
+ * whether or not a Perl progress object is set.
+ */
+void PerlClientUser::SetProgressStats(int enable)
+{
+	if (P4PERL_DEBUG_FLOW)
+		PerlIO_stdoutf("[PerlClientUser:SetProgressStats]: %d\n", enable);
+
+	if (enable && !progressStats)
+		progressStats = new P4ProgressStats;
+	else if (!enable && progressStats) {
+		delete progressStats;
+		progressStats = 0;
+	}
+}
+
+/*
+ * Enable or disable per-command timing statistics.
+ */
+void PerlClientUser::SetRunStats(int enable)
+{
+	if (enable && !runStats)
+		runStats = new P4RunStats;
+	else if (!enable && runStats) {
+		delete runStats;
+		runStats = 0;
+	}
+}
+
+/*
+ * Track output is parsed into a hash as it arrives, as well as being kept
+ * line by line in the results.
+ */
+void PerlClientUser::SetTrack(int t)
+{
+	track = t;
+	if (track && !trackStats)
+		trackStats = new P4TrackStats;
+	else if (!track && trackStats) {
+		delete trackStats;
+		trackStats = 0;
+	}
+}
+
+SV *
+PerlClientUser::GetTrackStats()
+{
+	if (!trackStats)
+		return &PL_sv_undef;
+	return trackStats->ToHash();
+}
+
+/*
+ * Enable or disable accounting of the memory used by command output.
+ */
+void PerlClientUser::SetRunMemory(int enable)
+{
+	if (enable && !runMemory)
+		runMemory = new P4RunMemory;
+	else if (!enable && runMemory) {
+		delete runMemory;
+		runMemory = 0;
+	}
+}
+
+HV *
+PerlClientUser::GetProgressStats()
+{
+	if (!progressStats)
+		return 0;
+	return progressStats->ToHash();
+}
+
 SV *
 PerlClientUser::MkMergeData(ClientMerge *m, StrPtr &h) {
 	if (P4PERL_DEBUG_FLOW)
@@ -43,6 +43,14 @@
  ******************************************************************************/
 class SpecMgr;
 class ClientProgress;
+class P4ProgressStats;
+class P4RunStats;
+class P4RunMemory;
+class P4TrackStats;
+class P4VirtualWorkspace;
+class P4SyncIOPolicy;
+class P4ResolvePolicy;
+class P4NativeHandler;
 
 class PerlClientUser: public ClientUser, public KeepAlive {
 public:
@@ -66,6 +74,8 @@ public:
 	ClientProgress *CreateProgress(int);
 	int ProgressIndicator();
 
+	FileSys *File(FileSysType type);
+
 	int IsAlive() {
 		return alive;
 	}
@@ -83,14 +93,55 @@ public:
 
 	void SetProgress(SV * p);
 	SV * GetProgress();
+	void SetRunStats(int enable);
+	P4RunStats * GetRunStats() {
+		return runStats;
+	}
+	void SetRunMemory(int enable);
+	P4RunMemory * GetRunMemory() {
+		return runMemory;
+	}
+	void SetProgressStats(int enable);
+	HV * GetProgressStats();
+	void SetProgressRate(int interval, long delta) {
+		progressInterval = interval;
+		progressDelta = delta;
+	}
 
-	void SetApiLevel(int l);
-	void SetTrack(int t) {
-		track = t;
+	// Whether to flag output strings as UTF-8: see P4Utf8::Mode. File
+	// content is handled separately as it's in the client's charset.
+	void SetUtf8Mode(int output, int text) {
+		outputUtf8 = output;
+		textUtf8 = text;
+		results.SetUtf8Mode(output);
+	}
+
+	// Takes ownership; 0 goes back to the real workspace
+	void SetVirtualWorkspace(P4VirtualWorkspace * w);
+	P4VirtualWorkspace * GetVirtualWorkspace() {
+		return workspace;
+	}
+	// Takes ownership; 0 goes back to the API's own files
+	void SetSyncIOPolicy(P4SyncIOPolicy * p);
+	P4SyncIOPolicy * GetSyncIOPolicy() {
+		return syncPolicy;
 	}
+
+	void SetApiLevel(int l);
+	void SetTrack(int t);
+	SV * GetTrackStats();
 	void SetResolver(SV * r) {
 		resolver = r;
 	}
+	// Takes ownership; 0 sends every resolve to the resolver
+	void SetResolvePolicy(P4ResolvePolicy * p);
+	// Accept clean merges without asking the resolver
+	void SetAutoResolve(int a) {
+		autoResolve = a;
+	}
+	int GetAutoResolve() {
+		return autoResolve;
+	}
 	P4Result& GetResults() {
 		return results;
 	}
@@ -111,6 +162,9 @@ private:
 	SV * MkActionMergeData(ClientResolveA *m, StrPtr &hint);
 	bool CallOutputMethod(const char * method, SV * data);
 	void ProcessOutput(const char * method, SV * data);
+	void InputSpec(HV * hv, StrBuf *strbuf, Error *e);
+	void InputHandle(SV * fh, StrBuf *strbuf, Error *e);
+	void InputCallback(SV * code, StrBuf *strbuf, Error *e);
 	void ProcessMessage(Error *e);
 
 private:
@@ -121,7 +175,20 @@ private:
 	SV * input;
 	SV * resolver;
 	SV * handler;
+	P4NativeHandler * native;
 	SV * progress;
+	int progressInterval;
+	long progressDelta;
+	P4ProgressStats * progressStats;
+	P4RunStats * runStats;
+	P4RunMemory * runMemory;
+	P4TrackStats * trackStats;
+	P4VirtualWorkspace * workspace;
+	P4SyncIOPolicy * syncPolicy;
+	P4ResolvePolicy * resolvePolicy;
+	int autoResolve;
+	int outputUtf8;
+	int textUtf8;
 	int debug;
 	int track;
 	int alive;
@@ -42,6 +42,7 @@
 #include "p4perldebug.h"
 #include "p4specdata.h"
 #include "specmgr.h"
+#include "p4utf8.h"
 
 struct defaultspec {
     const char *type;
@@ -331,6 +332,7 @@ struct defaultspec {
 SpecMgr::SpecMgr()
 {
 	debug = 0;
+	utf8Mode = 0;
 	specs = 0;
 	Reset();
 }
@@ -434,6 +436,7 @@ SpecMgr::StrDictToSpec(StrDict *dict, StrPtr *specDef)
 	// Now parse the StrBuf into a new P4::Spec object
 	SV * spec = NewSpec(specDef);
 	SpecDataPerl hashData(spec);
+	hashData.SetUtf8Mode(utf8Mode);
 
 	s.ParseNoValid(form.Text(), &hashData, &e);
 	if (e.Test())
@@ -469,6 +472,7 @@ SpecMgr::StringToSpec(const char *type, const char *form, Error *e)
 	StrPtr * specDef = specs->GetVar(type);
 	SV * hash = NewSpec(specDef);
 	SpecDataPerl specData(hash);
+	specData.SetUtf8Mode(utf8Mode);
 
 	if (!specDef)
 	{
@@ -602,6 +606,7 @@ SpecMgr::InsertItem(HV * hash, const StrPtr *var, const StrPtr *val)
 			PerlIO_stdoutf("\t[Simple]: %s -> %s\n", base.Text(), val->Text());
 
 		sv = newSVpv( val->Text(), val->Length() );
+		P4Utf8::Mark( sv, utf8Mode );
 		hv_store( hash, base.Text(), base.Length(), sv, 0);
 		return;
 	}
@@ -633,8 +638,9 @@ SpecMgr::InsertItem(HV * hash, const StrPtr *var, const StrPtr *val)
 		if (P4PERL_DEBUG_FORMCONV)
 			PerlIO_stdoutf("\t[Simple]: %s -> %s\n", var->Text(), val->Text());
 
-		hv_store( hash, var->Text(), var->Length(),
-				newSVpv( val->Text(), val->Length() ), 0);
+		sv = newSVpv( val->Text(), val->Length() );
+		P4Utf8::Mark( sv, utf8Mode );
+		hv_store( hash, var->Text(), var->Length(), sv, 0);
 		return;
 	}
 
@@ -686,7 +692,9 @@ SpecMgr::InsertItem(HV * hash, const StrPtr *var, const StrPtr *val)
 	if (P4PERL_DEBUG_FORMCONV)
 		PerlIO_stdoutf("%d] = %s\n", (int) av_len( av ) + 1, val->Text());
 
-	av_store( av, index.Atoi(), newSVpv( val->Text(), val->Length() ));
+	sv = newSVpv( val->Text(), val->Length() );
+	P4Utf8::Mark( sv, utf8Mode );
+	av_store( av, index.Atoi(), sv );
 }
 
 //
@@ -45,6 +45,7 @@ class SpecMgr
 		SpecMgr();
 		~SpecMgr();
 	void	SetDebug( int i )	{ debug = i; 	}
+	void	SetUtf8Mode( int m )	{ utf8Mode = m;	}
 
 	// Clear the spec cache and revert to internal defaults
 	void	Reset();
@@ -104,6 +105,7 @@ class SpecMgr
 
     private:
 	int		debug;
+	int		utf8Mode;
 	StrBufDict *	specs;
 };
 
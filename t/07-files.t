@@ -1,4 +1,4 @@
-use Test::More tests => 21;
+use Test::More tests => 42;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -97,3 +97,83 @@ ok( $rev2->Rev() == 2 );
 ok( scalar( @{ $rev2->Integrations() } == 2 ) );
 ok( $rev2->Integrations()->[0]->How() eq "branch into" );
 ok( $rev2->Integrations()->[0]->File() eq "//depot/test_branch/bar" );
+
+#
+# Results of immutable queries are answered from the result cache
+#
+$p4->SetResultCache( 1024 * 1024 );
+my ( $last ) = $p4->RunChanges( "-m1", "-s", "submitted" );
+my @d1 = $p4->RunDescribe( "-s", $last->{ 'change' } );
+my @d2 = $p4->RunDescribe( "-s", $last->{ 'change' } );
+is_deeply( \@d2, \@d1 );
+$p4->RunChanges( "-m1" );
+my $cs = $p4->ResultCacheStats();
+is( $cs->{ 'Hits' }, 1 );
+is( $cs->{ 'Entries' }, 1 );
+$p4->SetResultCache( 0 );
+ok( !defined( $p4->ResultCacheStats() ) );
+
+#
+# Printing a revision a second time is answered by the print cache
+#
+my $pc = new P4::PrintCache( "print_cache" );
+$p4->SetPrintCache( $pc );
+my @p1 = $p4->RunPrint( "//depot/test_files/foo#1" );
+my @p2 = $p4->RunPrint( "//depot/test_files/foo#1" );
+is( $pc->Stats()->{ 'Hits' }, 1 );
+is( $p2[ 0 ]->{ 'depotFile' }, "//depot/test_files/foo" );
+is( join( "", @p2[ 1 .. $#p2 ] ), join( "", @p1[ 1 .. $#p1 ] ) );
+$p4->SetPrintCache( undef );
+ok( !defined( $p4->GetPrintCache() ) );
+
+#
+# A parallel sync moves the files over extra connections
+#
+$p4->RunConfigure( "set", "net.parallel.max=4" );
+$p4->RunSync( "-f", "--parallel=threads=2,min=1,minsize=1", "//depot/test_files/..." );
+is( $p4->ErrorCount(), 0 );
+ok( -f "test_files/foo" && -f "test_files/bar" && -f "test_files/baz" );
+
+#
+# And a parallel submit sends them back the same way
+#
+$p4->SetParallelSubmit( 2, 1, 1, 1 );
+$p4->RunEdit( "test_files/..." );
+$p4->RunSubmit( "-d", "Parallel submit" );
+is( $p4->ErrorCount(), 0 );
+@opened = $p4->RunOpened();
+ok( scalar( @opened ) == 0 );
+$p4->SetParallelSubmit( 0 );
+
+#
+# A virtual workspace takes synced files instead of the client root
+#
+unlink( "test_files/foo" );
+my %ws;
+$p4->SetVirtualWorkspace( \%ws );
+$p4->RunSync( "-f", "//depot/test_files/foo" );
+my @vw = keys( %ws );
+is( scalar( @vw ), 1 );
+is( $ws{ $vw[ 0 ] }->{ 'content' }, "This is a test file\n" );
+my ( $fs ) = $p4->RunFstat( "-Ol", "//depot/test_files/foo" );
+is( $ws{ $vw[ 0 ] }->{ 'digest' }, $fs->{ 'digest' } );
+ok( ! -e "test_files/foo" );
+
+my @seen;
+$p4->SetVirtualWorkspace( sub { push( @seen, $_[ 2 ]->{ 'type' } ) } );
+$p4->RunSync( "-f", "//depot/test_files/..." );
+$p4->SetVirtualWorkspace( undef );
+is( join( ",", @seen ), "text,text,text" );
+
+#
+# Files synced under an IO policy are the same as without one
+#
+$p4->SetSyncIOPolicy( { buffer => 65536, presize => 1, fsync => 2 } );
+is( $p4->GetSyncIOPolicy()->{ 'fsync' }, 2 );
+$p4->RunSync( "-f", "//depot/test_files/..." );
+is( $p4->ErrorCount(), 0 );
+open( FH, "<test_files/foo" );
+is( join( "", <FH> ), "This is a test file\n" );
+close( FH );
+$p4->SetSyncIOPolicy( undef );
+ok( !defined( $p4->GetSyncIOPolicy() ) );
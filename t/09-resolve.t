@@ -1,4 +1,4 @@
-use Test::More tests => 9;
+use Test::More tests => 19;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -30,6 +30,8 @@ sub Resolve( $ )
     my $self = shift;
     my $mergeData = shift;
 
+    $self->{ 'calls' }++;
+    $self->{ 'stats' } = $mergeData->Stats();
     my $yourName = $mergeData->YourName();
     my $theirName = $mergeData->TheirName();
     my $baseName = $mergeData->BaseName();
@@ -76,6 +78,9 @@ $resolver = new MyResolver;
 $resolver->Setup( '//depot/test_files/foo', '//depot/test_branch/foo' );
 $p4->RunResolve( $resolver, "//depot/..." );
 ok( $resolver->Result() );
+is( $resolver->{ 'stats' }->{ 'ConflictChunks' }, 0 );
+is( $resolver->{ 'stats' }->{ 'YourLines' },
+    $resolver->{ 'stats' }->{ 'TheirLines' } );
 
 $change = $p4->FetchChange();
 $change->{ 'Description' } = "Integrate the test files";
@@ -85,3 +90,85 @@ $p4->RunSubmit( $change );
 ok( scalar( @opened ) == 0 );
 
 
+
+#
+# A resolve policy settles files natively, leaving the resolver only the
+# files sent to it
+#
+@files = $p4->RunEdit( 'test_files/bar', 'test_files/baz' );
+ok( scalar( @files ) == 2 );
+$p4->RunSubmit( "-d", "Editing the test files again" );
+
+@files = $p4->RunInteg( "test_files/...", "test_branch/..." );
+ok( scalar( @files ) == 2 );
+
+$p4->SetResolvePolicy( [ "//depot/test_files/..."	 => "at",
+			 "//depot/test_files/baz"	 => "perl" ] );
+$resolver = new MyResolver;
+$resolver->Setup( '//depot/test_files/baz', '//depot/test_branch/baz' );
+$p4->RunResolve( $resolver, "//depot/..." );
+is( $resolver->{ 'calls' }, 1 );
+$p4->SetResolvePolicy( undef );
+
+@files = $p4->RunResolve( "-n" );
+ok( scalar( @files ) == 0 );
+$p4->RunSubmit( "-d", "Integrate under a resolve policy" );
+
+#
+# With auto resolve on, clean merges never reach the resolver
+#
+$p4->RunEdit( 'test_files/foo' );
+$p4->RunSubmit( "-d", "Editing foo once more" );
+@files = $p4->RunInteg( "test_files/...", "test_branch/..." );
+ok( scalar( @files ) == 1 );
+
+$p4->SetAutoResolve( 1 );
+$resolver = new MyResolver;
+$resolver->Setup( '//depot/test_files/foo', '//depot/test_branch/foo' );
+$p4->RunResolve( $resolver, "//depot/..." );
+$p4->SetAutoResolve( 0 );
+ok( !$resolver->{ 'calls' } );
+$p4->RunSubmit( "-d", "Integrate with auto resolve" );
+
+#
+# A binary file changed on both sides has no conflict chunks to count,
+# but an 'am' rule must still leave it to the resolver
+#
+sub write_file( $$ )
+{
+    my ( $name, $content ) = @_;
+    open( my $fh, ">", $name ) or die( "Can't write $name" );
+    binmode( $fh );
+    print $fh $content;
+    close( $fh );
+}
+
+write_file( "test_files/both.bin", "\0\1\2 base\n" );
+$p4->RunAdd( "-t", "binary", "test_files/both.bin" );
+$p4->RunSubmit( "-d", "Add a binary file" );
+$p4->RunInteg( "test_files/both.bin", "test_branch/both.bin" );
+$p4->RunSubmit( "-d", "Branch the binary file" );
+
+$p4->RunEdit( "test_files/both.bin" );
+write_file( "test_files/both.bin", "\0\1\2 theirs\n" );
+$p4->RunSubmit( "-d", "Change the binary file on one side" );
+$p4->RunEdit( "test_branch/both.bin" );
+write_file( "test_branch/both.bin", "\0\1\2 yours\n" );
+$p4->RunSubmit( "-d", "Change the binary file on the other" );
+
+$p4->RunInteg( "test_files/both.bin", "test_branch/both.bin" );
+$p4->SetResolvePolicy( [ "//depot/test_files/..." => "am" ] );
+$resolver = new MyResolver;
+$resolver->Setup( '//depot/none', '//depot/none' );
+$p4->RunResolve( $resolver, "//depot/test_branch/both.bin" );
+$p4->SetResolvePolicy( undef );
+is( $resolver->{ 'calls' }, 1 );
+
+# Nor may auto resolve accept it
+$p4->SetAutoResolve( 1 );
+$resolver = new MyResolver;
+$resolver->Setup( '//depot/none', '//depot/none' );
+$p4->RunResolve( $resolver, "//depot/test_branch/both.bin" );
+$p4->SetAutoResolve( 0 );
+is( $resolver->{ 'calls' }, 1 );
+$p4->RunRevert( "//depot/test_branch/both.bin" );
@@ -1,4 +1,4 @@
-use Test::More tests => 23;
+use Test::More tests => 54;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -30,9 +30,36 @@ is( $p, "//ws/main/foo/bar", "Translated depot path" );
 $p = $map->Translate( "//ws/main/foo/bar", 0 );
 is( $p, "//depot/main/foo/bar", "Translated in reverse direction" );
 
+# Bulk translation
+$r = $map->TranslateArray( [ "//depot/main/foo", "//other/foo",
+			     "//depot/live/bar" ] );
+is( scalar( @$r ), 3, "Bulk translation returns one entry per path" );
+is_deeply( $r, [ "//ws/main/foo", undef, "//ws/live/bar" ],
+	   "Bulk translation leaves unmapped paths undefined" );
+
+$r = $map->TranslateArray( [ "//ws/main/foo", "//ws/live/bar" ], 0 );
+is_deeply( $r, [ "//depot/main/foo", "//depot/live/bar" ],
+	   "Bulk translation in reverse direction" );
+
+$r = $map->TranslateArray( [] );
+is( scalar( @$r ), 0, "Bulk translation of empty array" );
+
 # Map inclusion
 ok( $map->Includes( "//ws/main/foo/bar" ) );
 
+# Compiled inclusion tests
+ok( !$map->IsCompiled(), "Map not compiled by default" );
+$map->Compile();
+ok( $map->IsCompiled(), "Map compiled" );
+ok( $map->Includes( "//depot/main/foo" ), "Compiled Includes" );
+$r = $map->IncludesArray( [ "//depot/main/foo", "//ws/live/foo",
+			    "//depot/live/bad/foo", "//other/foo" ] );
+is_deeply( $r, [ 1, 1, 0, 0 ], "Bulk inclusion against compiled map" );
+$map->Insert( "//depot/other/...", "//ws/other/..." );
+ok( !$map->IsCompiled(), "Insert discards compiled index" );
+$r = $map->IncludesArray( [ "//depot/other/foo" ] );
+is_deeply( $r, [ 1 ], "Bulk inclusion recompiles after Insert" );
+
 # Map joining
 $ws_map = new P4::Map;
 $ws_map->Insert( "//ws/...", "/home/user/ws/..." );
@@ -41,6 +68,20 @@ ok( !$ws_map->IsEmpty() );
 $root_map = P4::Map::Join( $map, $ws_map );
 ok( !$root_map->IsEmpty() );
 
+# Multi-way joins
+$branch_map = new P4::Map( [ "//depot/dev/... //depot/main/..." ] );
+$all = P4::Map->JoinAll( $branch_map, $map, $ws_map );
+is( $all->Translate( "//depot/dev/foo/bar" ), "/home/user/ws/main/foo/bar",
+    "JoinAll across three maps" );
+$again = P4::Map->JoinAll( $branch_map, $map, $ws_map );
+is_deeply( [ $again->AsArray() ], [ $all->AsArray() ], "Cached JoinAll" );
+$again->Insert( "//depot/x/...", "/home/user/x/..." );
+is( P4::Map->JoinAll( $branch_map, $map, $ws_map )->Count(), $all->Count(),
+    "Modifying a JoinAll result doesn't affect the cache" );
+is( P4::Map::JoinAll( $map )->Count(), $map->Count(), "JoinAll of one map" );
+P4::Map->ClearJoinCache();
+ok( P4::Map->JoinAll()->IsEmpty(), "JoinAll of no maps" );
+
 # Now translate a depot path to a local path
 $p = $root_map->Translate( "//depot/main/foo/bar" );
 is( $p, "/home/user/ws/main/foo/bar" );
@@ -50,6 +91,29 @@ $root_map = $root_map->Reverse();
 $p = $root_map->Translate( "/home/user/ws/main/foo/bar" );
 is( $p, "//depot/main/foo/bar" );
 
+# Reversed views and clones share data until modified
+$rev = $root_map->Reverse();
+is( $rev->Translate( "//depot/main/foo/bar" ), "/home/user/ws/main/foo/bar",
+    "Reversed view translates" );
+is( $rev->Translate( "/home/user/ws/main/foo/bar", 0 ), "//depot/main/foo/bar",
+    "Reversed view translates backwards" );
+$simple = new P4::Map( [ "//a/... //b/..." ] );
+is_deeply( [ $simple->Reverse()->AsArray() ], [ "//b/... //a/..." ],
+	   "Reversed view swaps sides" );
+
+$clone = $root_map->Clone();
+$clone->Insert( "/tmp/...", "//depot/tmp/..." );
+is( $clone->Translate( "/tmp/foo" ), "//depot/tmp/foo", "Clone modified" );
+ok( !defined( $root_map->Translate( "/tmp/foo" ) ), "Original unaffected" );
+is( $clone->Translate( "/home/user/ws/main/foo/bar" ), "//depot/main/foo/bar",
+    "Clone of a reversed view keeps its original lines" );
+
+$rev->Insert( "//depot/extra/...", "/home/user/extra/..." );
+is( $rev->Translate( "//depot/extra/x" ), "/home/user/extra/x",
+    "Insert into reversed view" );
+is( $rev->Translate( "//depot/main/foo/bar" ), "/home/user/ws/main/foo/bar",
+    "Original lines survive an insert into a reversed view" );
+
 # Now clear the map and check it's empty
 ok( !$map->IsEmpty() );
 $map->Clear();
@@ -74,3 +138,24 @@ $p = $map->Translate( "//depot/space dir4/file" );
 is( $p, "//ws/space dir4/file" );
 $p = $map->Translate( "//depot/space dir5/file" );
 is( $p, "//ws/space dir5/file" );
+
+# Freeze and thaw
+$frozen = $map->Freeze();
+ok( length( $frozen ) > 0, "Froze map" );
+$thawed = P4::Map->Thaw( $frozen );
+ok( defined( $thawed ), "Thawed map" );
+is( $thawed->Count(), $map->Count(), "Thawed map has same entry count" );
+is_deeply( [ $thawed->AsArray() ], [ $map->AsArray() ],
+	   "Thawed map has same entries" );
+is( $thawed->Translate( "//depot/space dir3/file" ), "//ws/space dir3/file" );
+{
+    local $SIG{__WARN__} = sub {};
+    ok( !defined( P4::Map->Thaw( "garbage" ) ), "Thaw rejects bad data" );
+}
+
+my $mapfile = "$P4::Test::START_DIR/map.$$.bin";
+ok( $map->Save( $mapfile ), "Saved map" );
+$thawed = P4::Map->Load( $mapfile );
+is( $thawed->Translate( "//depot/space dir1/file" ), "//ws/space dir1/file",
+    "Loaded map translates" );
+unlink( $mapfile );
@@ -1,4 +1,4 @@
-use Test::More tests => 8;
+use Test::More tests => 10;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -23,4 +23,8 @@ ok( $p4->IsTrack() );
 $p4->Run( "info" );
 my @track = $p4->TrackOutput();
 ok( @track );
+
+my $stats = $p4->TrackStats();
+ok( defined( $stats->{ 'Lapse' } ) );
+ok( $stats->{ 'Rpc' }->{ 'MsgsIn' } > 0 );
 $p4->Disconnect();
@@ -1,4 +1,4 @@
-use Test::More tests => 11;
+use Test::More tests => 21;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -38,3 +38,27 @@ my $sub = sub { $p4->RunCounter( 'change' ) };
 $r = $p4->Tagged( 0, $sub );
 is( $r[ 0 ], $val );
 ok( $p4->IsTagged() );
+
+# Per-command statistics
+ok( !defined( $p4->LastRunStats() ) );
+$p4->SetRunStats( 1 );
+@r = $p4->RunCounter( 'change' );
+my $stats = $p4->LastRunStats();
+is( $stats->{ 'Command' }, "counter" );
+is( $stats->{ 'Records' }, 1 );
+ok( $stats->{ 'Wall' } >= $stats->{ 'Conversion' } );
+ok( $stats->{ 'Bytes' } > 0 );
+
+# Size hints don't change the results
+$p4->SetResultSizeHint( 1000 );
+@r = $p4->RunCounter( 'change' );
+is( scalar( @r ), 1 );
+
+# Output memory accounting
+ok( !defined( $p4->LastRunMemory() ) );
+$p4->SetRunMemory( 1 );
+@r = $p4->RunCounter( 'change' );
+my $mem = $p4->LastRunMemory();
+is( $mem->{ 'Records' }, 1 );
+is( $mem->{ 'HVs' }, 1 );
+ok( $mem->{ 'ResidentBytes' } >= $mem->{ 'LargestRecord' } );
@@ -1,4 +1,4 @@
-use Test::More tests => 6;
+use Test::More tests => 9;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -21,3 +21,28 @@ $p4->Debug( 7 );
 my $r = $p4->FetchClient();
 
 ok( length($r) != 0, "FetchClientOutput Empty");
+
+$p4->Debug( 0 );
+$p4->Tagged( 1 );
+
+# Forms may be supplied from a filehandle or a code ref
+my $client = $p4->FetchClient();
+$client->{ 'Description' } = "Saved from a filehandle\n";
+my $form = $p4->FormatClient( $client );
+open( my $fh, "<", \$form );
+$p4->SaveClient( $fh );
+close( $fh );
+like( $p4->FetchClient()->{ 'Description' }, qr/filehandle/ );
+
+$client->{ 'Description' } = "Saved from a code ref\n";
+my @lines = split( /^/, $p4->FormatClient( $client ) );
+$p4->SaveClient( sub { shift( @lines ) } );
+like( $p4->FetchClient()->{ 'Description' }, qr/code ref/ );
+
+# Any other reference is refused rather than sent as 'ARRAY(0x...)'
+my $warning = "";
+{
+    local $SIG{ __WARN__ } = sub { $warning .= shift };
+    eval { $p4->SaveClient( sub { [ "not", "a", "form" ] } ) };
+}
+like( $warning, qr/returned a reference/ );
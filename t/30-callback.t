@@ -1,4 +1,4 @@
-use Test::More tests => 13;
+use Test::More tests => 20;
 BEGIN { use_ok('P4'); }    ## test 1
 
 # Load test utils
@@ -37,6 +37,51 @@ ok( scalar(@s2) == 0 );     ## test 10
 my $c2 = $file_cb->getCount('outputStat');
 ok( $c2 == 9 );             ## test 11
 
+## native handlers: no Perl calls per record
+my $count = new P4::Handler::Count;
+$p4->SetHandler($count);
+my @n1 = $p4->RunFiles("//...");
+ok( scalar(@n1) == 0 && $count->Count() == 9 );     ## test 12
+
+my $collect = new P4::Handler::Collect("depotFile");
+$p4->SetHandler($collect);
+$p4->RunFiles("//...");
+is_deeply( $collect->Values(),
+    [ map { $_->{depotFile} } @s1 ] );                ## test 13
+
+my @want = grep { $_->{depotFile} =~ /foo/ } @s1;
+$p4->SetHandler( new P4::Handler::Grep( "depotFile" => qr/foo/ ) );
+my @n2 = $p4->RunFiles("//...");
+is_deeply( \@n2, \@want );                         ## test 14
+
+my $out = "";
+open( my $fh, ">", \$out );
+my $tofile = new P4::Handler::ToFile( $fh, "%depotFile%#%rev%" );
+$p4->SetHandler($tofile);
+my @n3 = $p4->RunFiles("//...");
+close($fh);
+ok( scalar(@n3) == 0 );                              ## test 15
+is( $out, join( "", map { "$_->{depotFile}#$_->{rev}\n" } @s1 ) );  ## test 16
+
+## JSON lines decode to the hashes the command would have returned
+require JSON::PP;
+$out = "";
+open( $fh, ">", \$out );
+$p4->SetHandler( new P4::Handler::ToFile( $fh, "json" ) );
+$p4->RunFiles("//...");
+close($fh);
+is_deeply( [ map { JSON::PP::decode_json($_) } split( /\n/, $out ) ],
+    \@s1 );                                          ## test 17
+
+my ($latest) = $p4->RunChanges("-m1");
+my @d = $p4->RunDescribe( "-s", $latest->{change} );
+$out = "";
+open( $fh, ">", \$out );
+$p4->SetHandler( new P4::Handler::ToFile( $fh, "json" ) );
+$p4->RunDescribe( "-s", $latest->{change} );
+close($fh);
+is_deeply( JSON::PP::decode_json($out), $d[0] );     ## test 18
+
 ## test break: mode 2/3
 diag("\nTest will abort callback, expect an RpcTransport message...");
 add_file( $p4, 100 );
@@ -55,10 +100,10 @@ else
     $file_cb->setReturn(3);
     $p4->SetHandler($file_cb);
     my @s3 = $p4->RunFiles("//...");
-    ok( scalar(@s3) == 0 );     ## test 12
+    ok( scalar(@s3) == 0 );     ## test 19
     my $c3 = $file_cb->getCount('outputStat');
     diag( "\nTotal callbacks logged : $c3");
-    ok( $c3 < 500 );            ## test 13
+    ok( $c3 < 500 );            ## test 20
 }
 
 
@@ -110,10 +155,10 @@ sub _win32_break_test {
     $file_cb->setReturn(3);
     $p4_tcp->SetHandler($file_cb);
     my @s3 = $p4_tcp->RunFiles("//...");
-    ok( scalar(@s3) == 0 );     ## test 12
+    ok( scalar(@s3) == 0 );     ## test 19
     my $c3 = $file_cb->getCount('outputStat');
     diag( "\nTotal callbacks logged : $c3" );
-    ok( $c3 < 500 );            ## test 13
+    ok( $c3 < 500 );            ## test 20
 
     $p4_tcp->Disconnect();
     $proc->Kill(0);
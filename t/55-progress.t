@@ -1,4 +1,4 @@
-use Test::More tests => 9;
+use Test::More tests => 16;
 BEGIN { use_ok('P4'); }    ## test 1
 
 # Load test utils
@@ -19,6 +19,8 @@ package TestProgress;
 		$count->{Update} = 0;
 		$count->{Total} = 0;
 		$count->{Done} = 0;
+		$count->{Positions} = [];
+		$count->{Expected} = undef;
 	}
 	
 	sub Description {
@@ -28,12 +30,16 @@ package TestProgress;
 	
 	sub Update {
 	    my $self = shift;
+	    my $position = shift;
 	    $count->{Update}++;
+		push( @{ $count->{Positions} }, $position );
 	}
 	
 	sub Total {
 	    my $self = shift;
+	    my $total = shift;
 	    $count->{Total}++;
+		$count->{Expected} = $total;
 	}
 	
 	sub Done {
@@ -84,4 +90,29 @@ ok( scalar( $c->{Done} ) == 1 );			## test 8
 
 ok( scalar( $c->{Update} ) > 0 );			## test 9
 
+my $updates = $c->{Update};
 
+
+## coalesced updates: fewer calls, but the final position is still delivered
+$p4->SetProgressRate( 60000, 1000000 );
+$p4->SetProgress($progress);
+$p4->RunSync("-f", "-q", "//...");
+$c = $progress->getCount();
+ok( scalar( $c->{Done} ) == 1 );			## test 10
+ok( $c->{Update} < $updates );				## test 11
+is( $c->{Positions}->[-1], $c->{Expected} );		## test 12
+
+## native progress statistics, with no Perl progress object
+$p4 = $test->InitClient();
+$p4->Connect();
+ok( !defined( $p4->ProgressStats() ) );			## test 13
+$p4->SetProgressStats( 1 );
+$p4->RunSync("-f", "-q", "//...");
+my $stats = $p4->ProgressStats();
+is( ref( $stats ), "HASH" );				## test 14
+ok( !grep { !exists( $_->{Position} ) } values( %$stats ) );	## test 15
+
+## the file transfer was recorded, and ran to completion
+my ( $xfer ) = grep { defined } @$stats{ 2, 3 };
+ok( defined( $xfer ) && $xfer->{Done} == 1
+	&& $xfer->{Position} == $xfer->{Total} );		## test 16
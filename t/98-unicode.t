@@ -1,4 +1,4 @@
-use Test::More tests => 8;
+use Test::More tests => 11;
 BEGIN { use_ok( 'P4' ); }
 
 # Load test utils
@@ -49,3 +49,12 @@ chomp( $buf );
 close( FH );
 
 ok( $buf eq "This file cost \xc2\xa31" );
+
+# With UTF-8 output enabled, the printed content comes back as a
+# character string rather than as UTF-8 bytes.
+
+$p4->SetOutputUtf8( 1 );
+my @p = $p4->RunPrint( $tf );
+ok( utf8::is_utf8( $p[ 1 ] ) );
+is( $p[ 1 ], "This file cost \x{a3}1\n" );
+ok( !utf8::is_utf8( $p[ 0 ]->{ 'depotFile' } ) );